@@ -9,27 +9,69 @@
 #include "globals.h"
 #include "symtab.h"
 #include "analyze.h"
+#include "stats.h"
 
 /* counter for variable memory locations */
 static int location = 0;
 
-/* Procedure traverse is a generic recursive 
- * syntax tree traversal routine:
- * it applies preProc in preorder and postProc 
- * in postorder to tree pointed to by t
+/* TravFrame records a node whose subtrees are
+ * being traversed and the next child to visit
+ */
+typedef struct
+   { TreeNode * node;
+     int child;
+   } TravFrame;
+
+/* initial depth of the traversal stack */
+#define TRAVSTACK 64
+
+/* Procedure traverse is a generic syntax tree
+ * traversal routine:
+ * it applies preProc in preorder and postProc
+ * in postorder to tree pointed to by t.
+ * Pending nodes are kept on a heap-allocated
+ * stack and siblings replace each other in the
+ * same frame, so neither deep nesting nor long
+ * statement lists grow the C call stack
  */
 static void traverse( TreeNode * t,
                void (* preProc) (TreeNode *),
                void (* postProc) (TreeNode *) )
-{ if (t != NULL)
-  { preProc(t);
-    { int i;
-      for (i=0; i < MAXCHILDREN; i++)
-        traverse(t->child[i],preProc,postProc);
+{ TravFrame * stack;
+  int top = 0, size = TRAVSTACK;
+  if (t == NULL) return;
+  stack = (TravFrame *) tagAlloc(AnalyzeMem,size * sizeof(TravFrame));
+  preProc(t);
+  stack[top].node = t;
+  stack[top].child = 0;
+  top++;
+  while (top > 0)
+  { TravFrame * f = &stack[top-1];
+    if (f->child < MAXCHILDREN)
+    { TreeNode * c = f->node->child[f->child++];
+      if (c != NULL)
+      { if (top == size)
+        { size *= 2;
+          stack = (TravFrame *) tagRealloc(AnalyzeMem,stack,size * sizeof(TravFrame));
+        }
+        preProc(c);
+        stack[top].node = c;
+        stack[top].child = 0;
+        top++;
+      }
+    }
+    else
+    { postProc(f->node);
+      if (f->node->sibling != NULL)
+      { f->node = f->node->sibling;
+        f->child = 0;
+        preProc(f->node);
+      }
+      else
+        top--;
     }
-    postProc(t);
-    traverse(t->sibling,preProc,postProc);
   }
+  free(stack);
 }
 
 /* nullProc is a do-nothing procedure to 
@@ -11,6 +11,8 @@
 #include "symtab.h"
 #include "code.h"
 #include "cgen.h"
+#include "peep.h"
+#include "stats.h"
 
 /* tmpOffset is the memory offset for temps
    It is decremented each time a temp is
@@ -18,14 +20,153 @@
 */
 static int tmpOffset = 0;
 
+/* regTop is the next of the registers firstReg to
+ * lastReg free for a temp; the ones below it hold
+ * operands
+ */
+static int regTop = firstReg;
+
 /* prototype for internal recursive code generator */
 static void cGen (TreeNode * tree);
 
+/* isLeaf tells whether expression tree is loaded
+ * by a single instruction
+ */
+static int isLeaf( TreeNode * tree)
+{ return tree->nodekind == ExpK &&
+         (tree->kind.exp == ConstK || tree->kind.exp == IdK);
+}
+
+/* Function regNeed returns the number of the
+ * registers firstReg to lastReg that the code for
+ * expression tree needs to keep its operands (its
+ * Sethi-Ullman number); a leaf operand is loaded
+ * straight into ac1
+ */
+static int regNeed( TreeNode * tree)
+{ int l, r;
+  if (tree->nodekind != ExpK || tree->kind.exp != OpK)
+    return 0;
+  l = regNeed(tree->child[0]);
+  r = regNeed(tree->child[1]);
+  if (isLeaf(tree->child[0]) || isLeaf(tree->child[1]) || l != r)
+    return l > r ? l : r;
+  return l + 1;
+}
+
+/* genLeaf loads leaf expression tree into register r */
+static void genLeaf( TreeNode * tree, int r)
+{ if (tree->kind.exp == ConstK)
+    emitRM("LDC",r,tree->attr.val,0,"load const");
+  else
+    emitRM("LD",r,st_lookup(tree->attr.name),gp,"load id value");
+}
+
+/* genOp generates code for ac = left op right */
+static void genOp( TokenType op, int left, int right)
+{ switch (op) {
+    case PLUS :
+       emitRO("ADD",ac,left,right,"op +");
+       break;
+    case MINUS :
+       emitRO("SUB",ac,left,right,"op -");
+       break;
+    case TIMES :
+       emitRO("MUL",ac,left,right,"op *");
+       break;
+    case OVER :
+       emitRO("DIV",ac,left,right,"op /");
+       break;
+    case LT :
+       emitRO("SUB",ac,left,right,"op <") ;
+       emitRM("JLT",ac,2,pc,"br if true") ;
+       emitRM("LDC",ac,0,ac,"false case") ;
+       emitRM("LDA",pc,1,pc,"unconditional jmp") ;
+       emitRM("LDC",ac,1,ac,"true case") ;
+       break;
+    case EQ :
+       emitRO("SUB",ac,left,right,"op ==") ;
+       emitRM("JEQ",ac,2,pc,"br if true");
+       emitRM("LDC",ac,0,ac,"false case") ;
+       emitRM("LDA",pc,1,pc,"unconditional jmp") ;
+       emitRM("LDC",ac,1,ac,"true case") ;
+       break;
+    default:
+       emitComment("BUG: Unknown operator");
+       break;
+  } /* case op */
+}
+
+/* genOperands generates code for the operands of
+ * operator node tree, and puts the registers that
+ * hold them in *left and *right
+ */
+static void genOperands( TreeNode * tree, int * left, int * right)
+{ TreeNode * p1 = tree->child[0], * p2 = tree->child[1];
+  int r;
+  if (isLeaf(p2))
+  { /* gen code for ac = left arg, ac1 = right */
+    cGen(p1);
+    genLeaf(p2,ac1);
+    *left = ac;
+    *right = ac1;
+  }
+  else if (isLeaf(p1))
+  { /* gen code for ac = right arg, ac1 = left */
+    cGen(p2);
+    genLeaf(p1,ac1);
+    *left = ac1;
+    *right = ac;
+  }
+  else
+  { /* the operand needing more registers goes
+     * first, and is kept while the other is
+     * computed
+     */
+    int leftFirst = regNeed(p1) >= regNeed(p2);
+    cGen(leftFirst ? p1 : p2);
+    if (regTop <= lastReg)
+    { r = regTop++;
+      emitRM("LDA",r,0,ac,"op: keep operand");
+      cGen(leftFirst ? p2 : p1);
+      regTop--;
+    }
+    else
+    { /* all registers are taken: spill */
+      emitRM_Tmp("ST",ac,tmpOffset--,mp,"op: push operand");
+      cGen(leftFirst ? p2 : p1);
+      emitRM_Tmp("LD",ac1,++tmpOffset,mp,"op: load operand");
+      r = ac1;
+    }
+    *left = leftFirst ? r : ac;
+    *right = leftFirst ? ac : r;
+  }
+}
+
+/* genCond generates code for the test of an if or
+ * a repeat, and returns the jump on ac taken when
+ * the test is false: a comparison is not turned
+ * into 0 or 1, the jump tests the difference of
+ * its operands
+ */
+static char * genCond( TreeNode * tree)
+{ int left, right;
+  if (tree->nodekind == ExpK && tree->kind.exp == OpK &&
+      (tree->attr.op == LT || tree->attr.op == EQ))
+  { genOperands(tree,&left,&right);
+    emitRO("SUB",ac,left,right,"op compare");
+    return tree->attr.op == LT ? "JGE" : "JNE";
+  }
+  cGen(tree);
+  return "JEQ";
+}
+
 /* Procedure genStmt generates code at a statement node */
 static void genStmt( TreeNode * tree)
 { TreeNode * p1, * p2, * p3;
   int savedLoc1,savedLoc2,currentLoc;
   int loc;
+  char * jmp;
   switch (tree->kind.stmt) {
 
       case IfK :
@@ -34,7 +175,7 @@ static void genStmt( TreeNode * tree)
          p2 = tree->child[1] ;
          p3 = tree->child[2] ;
          /* generate code for test expression */
-         cGen(p1);
+         jmp = genCond(p1);
          savedLoc1 = emitSkip(1) ;
          emitComment("if: jump to else belongs here");
          /* recurse on then part */
@@ -43,7 +184,7 @@ static void genStmt( TreeNode * tree)
          emitComment("if: jump to end belongs here");
          currentLoc = emitSkip(0) ;
          emitBackup(savedLoc1) ;
-         emitRM_Abs("JEQ",ac,currentLoc,"if: jmp to else");
+         emitRM_Abs(jmp,ac,currentLoc,"if: jmp to else");
          emitRestore() ;
          /* recurse on else part */
          cGen(p3);
@@ -63,8 +204,8 @@ static void genStmt( TreeNode * tree)
          /* generate code for body */
          cGen(p1);
          /* generate code for test */
-         cGen(p2);
-         emitRM_Abs("JEQ",ac,savedLoc1,"repeat: jmp back to body");
+         jmp = genCond(p2);
+         emitRM_Abs(jmp,ac,savedLoc1,"repeat: jmp back to body");
          if (TraceCode)  emitComment("<- repeat") ;
          break; /* repeat */
 
@@ -96,8 +237,7 @@ static void genStmt( TreeNode * tree)
 
 /* Procedure genExp generates code at an expression node */
 static void genExp( TreeNode * tree)
-{ int loc;
-  TreeNode * p1, * p2;
+{ int loc, left, right;
   switch (tree->kind.exp) {
 
     case ConstK :
@@ -116,47 +256,8 @@ static void genExp( TreeNode * tree)
 
     case OpK :
          if (TraceCode) emitComment("-> Op") ;
-         p1 = tree->child[0];
-         p2 = tree->child[1];
-         /* gen code for ac = left arg */
-         cGen(p1);
-         /* gen code to push left operand */
-         emitRM("ST",ac,tmpOffset--,mp,"op: push left");
-         /* gen code for ac = right operand */
-         cGen(p2);
-         /* now load left operand */
-         emitRM("LD",ac1,++tmpOffset,mp,"op: load left");
-         switch (tree->attr.op) {
-            case PLUS :
-               emitRO("ADD",ac,ac1,ac,"op +");
-               break;
-            case MINUS :
-               emitRO("SUB",ac,ac1,ac,"op -");
-               break;
-            case TIMES :
-               emitRO("MUL",ac,ac1,ac,"op *");
-               break;
-            case OVER :
-               emitRO("DIV",ac,ac1,ac,"op /");
-               break;
-            case LT :
-               emitRO("SUB",ac,ac1,ac,"op <") ;
-               emitRM("JLT",ac,2,pc,"br if true") ;
-               emitRM("LDC",ac,0,ac,"false case") ;
-               emitRM("LDA",pc,1,pc,"unconditional jmp") ;
-               emitRM("LDC",ac,1,ac,"true case") ;
-               break;
-            case EQ :
-               emitRO("SUB",ac,ac1,ac,"op ==") ;
-               emitRM("JEQ",ac,2,pc,"br if true");
-               emitRM("LDC",ac,0,ac,"false case") ;
-               emitRM("LDA",pc,1,pc,"unconditional jmp") ;
-               emitRM("LDC",ac,1,ac,"true case") ;
-               break;
-            default:
-               emitComment("BUG: Unknown operator");
-               break;
-         } /* case op */
+         genOperands(tree,&left,&right);
+         genOp(tree->attr.op,left,right);
          if (TraceCode)  emitComment("<- Op") ;
          break; /* OpK */
 
@@ -194,7 +295,7 @@ static void cGen( TreeNode * tree)
  * file name as a comment in the code file
  */
 void codeGen(TreeNode * syntaxTree, char * codefile)
-{  char * s = malloc(strlen(codefile)+7);
+{  char * s = tagAlloc(CodeGenMem,strlen(codefile)+7);
    strcpy(s,"File: ");
    strcat(s,codefile);
    emitComment("TINY Compilation to TM Code");
@@ -209,4 +310,6 @@ void codeGen(TreeNode * syntaxTree, char * codefile)
    /* finish */
    emitComment("End of execution.");
    emitRO("HALT",0,0,0,"");
+   if (Optimize) peephole();
+   emitFlush();
 }
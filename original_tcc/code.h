@@ -29,6 +29,23 @@
 /* 2nd accumulator */
 #define  ac1 1
 
+/* registers firstReg to lastReg are not used by
+ * the runtime, and keep temps
+ */
+#define firstReg 2
+#define lastReg 4
+
+/* Instr is one emitted instruction; a location
+ * skipped and never backpatched has no opcode
+ */
+typedef struct
+   { char * op;
+     int isRO;   /* register-only, else register-to-memory */
+     int r, s, t; /* t is the offset of a register-to-memory */
+     int isTemp; /* pushes or pops a temp */
+     char * comment;
+   } Instr;
+
 /* code emitting utilities */
 
 /* Procedure emitComment prints a comment line 
@@ -73,6 +90,13 @@ void emitBackup( int loc);
  */
 void emitRestore(void);
 
+/* Procedure emitRM_Tmp emits a register-to-memory
+ * TM instruction that pushes or pops a temp, which
+ * is read only by its pop; the arguments are those
+ * of emitRM
+ */
+void emitRM_Tmp( char * op, int r, int d, int s, char *c);
+
 /* Procedure emitRM_Abs converts an absolute reference 
  * to a pc-relative reference when emitting a
  * register-to-memory TM instruction
@@ -83,4 +107,22 @@ void emitRestore(void);
  */
 void emitRM_Abs( char *op, int r, int a, char * c);
 
+/* Function codeBuffer returns the instructions
+ * emitted so far, by location, and their number
+ * in *n; a pass may change them in place
+ */
+Instr * codeBuffer( int * n);
+
+/* Procedure emitCompact removes the locations
+ * without an opcode, moving the instructions after
+ * them up and adjusting pc-relative offsets
+ */
+void emitCompact(void);
+
+/* Procedure emitFlush writes the instructions
+ * emitted, in location order, to the code file
+ * and empties the buffer
+ */
+void emitFlush(void);
+
 #endif
@@ -99,6 +99,24 @@ extern int TraceAnalyze;
  */
 extern int TraceCode;
 
+/* TimeReport = TIME_TABLE or TIME_JSON (see stats.h)
+ * makes the compiler report the time of each phase,
+ * its token, node, symbol and scope counts and the
+ * counts of what the optimizations did
+ */
+extern int TimeReport;
+
+/* MemReport = TRUE makes the compiler report at exit
+ * the memory allocated by each subsystem and its
+ * peak resident set size
+ */
+extern int MemReport;
+
+/* Optimize = FALSE turns off the optimization of
+ * the generated code
+ */
+extern int Optimize;
+
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error; 
 #endif
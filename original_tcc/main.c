@@ -18,6 +18,7 @@
 #define NO_CODE FALSE
 
 #include "util.h"
+#include "stats.h"
 #if NO_PARSE
 #include "scan.h"
 #else
@@ -43,16 +44,36 @@ int TraceParse = FALSE;
 int TraceAnalyze = FALSE;
 int TraceCode = FALSE;
 
+/* allocate and set reporting options */
+int TimeReport = FALSE;
+int MemReport = FALSE;
+int Optimize = TRUE;
+
 int Error = FALSE;
 
 main( int argc, char * argv[] )
 { TreeNode * syntaxTree;
   char pgm[120]; /* source code file name */
-  if (argc != 2)
-    { fprintf(stderr,"usage: %s <filename>\n",argv[0]);
+  int i;
+  for (i=1;i<argc-1;i++)
+  { if (strcmp(argv[i],"-time") == 0)
+      TimeReport = TIME_TABLE;
+    else if (strcmp(argv[i],"-time=json") == 0)
+      TimeReport = TIME_JSON;
+    else if (strcmp(argv[i],"-mem") == 0)
+      MemReport = TRUE;
+    else if (strcmp(argv[i],"-O0") == 0)
+      Optimize = FALSE;
+    else
+      break;
+  }
+  if (argc != i+1)
+    { fprintf(stderr,"usage: %s [-time[=json]] [-mem] [-O0] <filename>\n",argv[0]);
       exit(1);
     }
-  strcpy(pgm,argv[1]) ;
+  if (MemReport)
+    atexit(printMemStats);
+  strcpy(pgm,argv[i]) ;
   if (strchr (pgm, '.') == NULL)
      strcat(pgm,".tny");
   source = fopen(pgm,"r");
@@ -65,7 +86,9 @@ main( int argc, char * argv[] )
 #if NO_PARSE
   while (getToken()!=ENDFILE);
 #else
+  phaseBegin(ParsePhase);
   syntaxTree = parse();
+  phaseEnd(ParsePhase);
   if (TraceParse) {
     fprintf(listing,"\nSyntax tree:\n");
     printTree(syntaxTree);
@@ -73,16 +96,20 @@ main( int argc, char * argv[] )
 #if !NO_ANALYZE
   if (! Error)
   { if (TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table...\n");
+    phaseBegin(SymtabPhase);
     buildSymtab(syntaxTree);
+    phaseEnd(SymtabPhase);
     if (TraceAnalyze) fprintf(listing,"\nChecking Types...\n");
+    phaseBegin(TypeCheckPhase);
     typeCheck(syntaxTree);
+    phaseEnd(TypeCheckPhase);
     if (TraceAnalyze) fprintf(listing,"\nType Checking Finished\n");
   }
 #if !NO_CODE
   if (! Error)
   { char * codefile;
     int fnlen = strcspn(pgm,".");
-    codefile = (char *) calloc(fnlen+4, sizeof(char));
+    codefile = (char *) tagCalloc(OtherMem,fnlen+4, sizeof(char));
     strncpy(codefile,pgm,fnlen);
     strcat(codefile,".tm");
     code = fopen(codefile,"w");
@@ -90,12 +117,15 @@ main( int argc, char * argv[] )
     { printf("Unable to open %s\n",codefile);
       exit(1);
     }
+    phaseBegin(CodeGenPhase);
     codeGen(syntaxTree,codefile);
+    phaseEnd(CodeGenPhase);
     fclose(code);
   }
 #endif
 #endif
 #endif
+  if (TimeReport) printStats();
   fclose(source);
   return 0;
 }
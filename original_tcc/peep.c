@@ -0,0 +1,231 @@
+/****************************************************/
+/* File: peep.c                                     */
+/* Peephole optimizer implementation for the TM     */
+/* code generators                                  */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+#include "peep.h"
+#include "stats.h"
+
+/* the longest run of instructions between a push
+ * and the pop of a temp kept in a register
+ */
+#define WINDOW 16
+
+static Instr * instrs;
+static int nInstrs;
+
+/* isTarget[loc] = TRUE if a pc-relative offset
+ * refers to location loc
+ */
+static int * isTarget;
+
+/* hits of each pattern */
+static long pairHits, nextHits, chainHits;
+
+static int isOp(Instr * i, char * op)
+{ return i->op != NULL && strcmp(i->op,op) == 0;
+}
+
+/* a conditional jump */
+static int isCondJump(Instr * i)
+{ return !i->isRO && i->op[0] == 'J';
+}
+
+/* an unconditional pc-relative jump */
+static int isGoto(Instr * i)
+{ return isOp(i,"LDA") && i->r == pc && i->s == pc;
+}
+
+/* reads tells whether instruction i reads register r */
+static int reads(Instr * i, int r)
+{ if (i->isRO)
+  { if (isOp(i,"HALT") || isOp(i,"IN"))
+      return FALSE;
+    if (isOp(i,"OUT"))
+      return i->r == r;
+    return i->s == r || i->t == r;
+  }
+  if (isOp(i,"LDC"))
+    return FALSE;
+  if (isOp(i,"LD") || isOp(i,"LDA"))
+    return i->s == r;
+  return i->r == r || i->s == r; /* ST and jumps */
+}
+
+/* writes tells whether instruction i sets register r */
+static int writes(Instr * i, int r)
+{ if (i->isRO)
+    return !isOp(i,"HALT") && !isOp(i,"OUT") && i->r == r;
+  if (isOp(i,"ST") || isCondJump(i))
+    return FALSE;
+  return i->r == r;
+}
+
+/* a jump, a return or the end of the program */
+static int isBranch(Instr * i)
+{ return isOp(i,"HALT") || isCondJump(i) || writes(i,pc);
+}
+
+static void findTargets(void)
+{ int loc;
+  for (loc=0;loc<=nInstrs;loc++)
+    isTarget[loc] = FALSE;
+  for (loc=0;loc<nInstrs;loc++)
+  { Instr * i = &instrs[loc];
+    if (i->op != NULL && !i->isRO && i->s == pc)
+    { int a = loc + 1 + i->t;
+      /* a removed location stands for the next */
+      while (a >= 0 && a < nInstrs && instrs[a].op == NULL)
+        a++;
+      if (a >= 0 && a <= nInstrs)
+        isTarget[a] = TRUE;
+    }
+  }
+}
+
+/* next returns the location of the instruction
+ * after loc, skipping removed ones
+ */
+static int next(int loc)
+{ do loc++; while (loc < nInstrs && instrs[loc].op == NULL);
+  return loc;
+}
+
+/* chainJumps makes each jump to an unconditional
+ * jump go where that one goes
+ */
+static int chainJumps(void)
+{ int loc, changed = FALSE;
+  for (loc=0;loc<nInstrs;loc++)
+  { Instr * i = &instrs[loc];
+    int a, hops = 0;
+    if (i->op == NULL || !(isGoto(i) || (isCondJump(i) && i->s == pc)))
+      continue;
+    a = loc + 1 + i->t;
+    while (a >= 0 && a < nInstrs && a != loc && hops < nInstrs &&
+           isGoto(&instrs[a]) && instrs[a].t != -1)
+    { a = a + 1 + instrs[a].t;
+      hops++;
+    }
+    if (hops > 0)
+    { i->t = a - (loc + 1);
+      chainHits++;
+      changed = TRUE;
+    }
+  }
+  return changed;
+}
+
+/* dropNextJumps removes the jumps to the next
+ * instruction
+ */
+static int dropNextJumps(void)
+{ int loc, changed = FALSE;
+  for (loc=0;loc<nInstrs;loc++)
+  { Instr * i = &instrs[loc];
+    if (i->op != NULL && (isGoto(i) || (isCondJump(i) && i->s == pc)) &&
+        loc + 1 + i->t == next(loc))
+    { i->op = NULL;
+      nextHits++;
+      changed = TRUE;
+    }
+  }
+  return changed;
+}
+
+/* keepTemp keeps the temp pushed at loc in a
+ * register, if it is popped within WINDOW
+ * instructions that leave the register alone and
+ * that control enters only from the push
+ */
+static int keepTemp(int loc)
+{ Instr * st = &instrs[loc], * ld;
+  int k, j, n = 0;
+  for (j=next(loc);j<nInstrs && n<WINDOW;j=next(j),n++)
+  { Instr * i = &instrs[j];
+    if (isTarget[j] || isBranch(i) || writes(i,st->s))
+      return FALSE;
+    if (i->isTemp && isOp(i,"LD") && i->s == st->s && i->t == st->t)
+      break;
+  }
+  if (j >= nInstrs || n >= WINDOW)
+    return FALSE;
+  ld = &instrs[j];
+  for (k=next(loc);k<j;k=next(k))
+  { Instr * i = &instrs[k];
+    if (reads(i,ld->r) || writes(i,ld->r))
+      return FALSE;
+    if (ld->r == st->r && writes(i,st->r))
+      return FALSE;
+  }
+  if (ld->r == st->r)
+    st->op = NULL;
+  else
+  { st->op = "LDA";
+    st->t = 0;
+    st->s = st->r;
+    st->r = ld->r;
+    st->isTemp = FALSE;
+  }
+  ld->op = NULL;
+  return TRUE;
+}
+
+/* dropReload removes the load right after the
+ * store at loc of the same word, or copies the
+ * register stored
+ */
+static int dropReload(int loc)
+{ Instr * st = &instrs[loc], * ld;
+  int j = next(loc);
+  if (j >= nInstrs || isTarget[j])
+    return FALSE;
+  ld = &instrs[j];
+  if (!isOp(ld,"LD") || ld->s != st->s || ld->t != st->t ||
+      st->s == pc || ld->r == pc)
+    return FALSE;
+  if (ld->r == st->r)
+    ld->op = NULL;
+  else
+  { ld->op = "LDA";
+    ld->s = st->r;
+    ld->t = 0;
+  }
+  return TRUE;
+}
+
+/* dropPairs removes redundant store/load pairs */
+static int dropPairs(void)
+{ int loc, changed = FALSE;
+  findTargets();
+  for (loc=0;loc<nInstrs;loc++)
+  { Instr * i = &instrs[loc];
+    if (!isOp(i,"ST"))
+      continue;
+    if ((i->isTemp && keepTemp(loc)) || dropReload(loc))
+    { pairHits++;
+      changed = TRUE;
+    }
+  }
+  return changed;
+}
+
+void peephole(void)
+{ int changed = TRUE;
+  pairHits = nextHits = chainHits = 0;
+  while (changed)
+  { instrs = codeBuffer(&nInstrs);
+    isTarget = (int *) tagAlloc(CodeGenMem,(nInstrs+1) * sizeof(int));
+    changed = chainJumps();
+    changed |= dropNextJumps();
+    changed |= dropPairs();
+    free(isTarget);
+    emitCompact();
+  }
+  countEvent("peep st/ld",pairHits);
+  countEvent("peep jmp+1",nextHits);
+  countEvent("peep jmp>jmp",chainHits);
+}
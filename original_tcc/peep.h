@@ -0,0 +1,20 @@
+/****************************************************/
+/* File: peep.h                                     */
+/* Peephole optimizer interface for the TM code     */
+/* generators                                       */
+/****************************************************/
+
+#ifndef _PEEP_H_
+#define _PEEP_H_
+
+/* Procedure peephole rewrites the instructions
+ * emitted so far: a temp pushed and popped again
+ * is kept in a register, a value stored and loaded
+ * again is not loaded, and jumps to the next
+ * instruction or to another jump are removed or
+ * retargeted. The hits of each pattern are counted
+ * (see countEvent)
+ */
+void peephole(void);
+
+#endif
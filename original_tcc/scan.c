@@ -8,6 +8,7 @@
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
+#include "stats.h"
 
 /* states in scanner DFA */
 typedef enum
@@ -198,6 +199,7 @@ TokenType getToken(void)
      fprintf(listing,"\t%d: ",lineno);
      printToken(currentToken,tokenString);
    }
+   tokenCount++;
    return currentToken;
 } /* end getToken */
 
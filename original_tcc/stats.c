@@ -0,0 +1,151 @@
+/****************************************************/
+/* File: stats.c                                    */
+/* Phase timing and counters for the TINY compiler  */
+/****************************************************/
+
+#include <time.h>
+#include <sys/resource.h>
+#include "globals.h"
+#include "symtab.h"
+#include "stats.h"
+
+long tokenCount = 0;
+long nodeCount = 0;
+
+static char * phaseName[PHASES] =
+   { "parse", "symtab", "typecheck", "optimize", "codegen" };
+
+/* accumulated times in seconds, the number of runs,
+ * and the start of the current run of each phase
+ */
+static struct
+   { double wall, cpu;
+     int runs;
+     struct timespec wallStart, cpuStart;
+   } phases[PHASES];
+
+static double seconds(struct timespec t)
+{ return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+void phaseBegin(Phase p)
+{ if (!TimeReport) return;
+  clock_gettime(CLOCK_MONOTONIC,&phases[p].wallStart);
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID,&phases[p].cpuStart);
+}
+
+void phaseEnd(Phase p)
+{ struct timespec wall, cpu;
+  if (!TimeReport) return;
+  clock_gettime(CLOCK_MONOTONIC,&wall);
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID,&cpu);
+  phases[p].wall += seconds(wall) - seconds(phases[p].wallStart);
+  phases[p].cpu += seconds(cpu) - seconds(phases[p].cpuStart);
+  phases[p].runs++;
+}
+
+/* the optimization counters, in the order of
+ * their first event
+ */
+#define MAXEVENTS 32
+
+static struct
+   { char * name;
+     long count;
+   } events[MAXEVENTS];
+static int nEvents = 0;
+
+void countEvent(char * name, long n)
+{ int e;
+  for (e=0;e<nEvents && strcmp(events[e].name,name)!=0;e++)
+    ;
+  if (e == nEvents)
+  { if (nEvents == MAXEVENTS)
+      return;
+    events[nEvents].name = name;
+    events[nEvents++].count = 0;
+  }
+  events[e].count += n;
+}
+
+void printStats(void)
+{ double wall = 0, cpu = 0;
+  int p, e, first = TRUE;
+  long nSymbols = st_symbol_count();
+  int nScopes = 1; /* TINY has one global scope */
+  if (TimeReport == TIME_JSON)
+  { fprintf(stderr,"{\"phases\": {");
+    for (p=0;p<PHASES;p++)
+      if (phases[p].runs > 0)
+      { fprintf(stderr,"%s\"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}",
+                first ? "" : ", ",phaseName[p],
+                phases[p].wall * 1e3,phases[p].cpu * 1e3);
+        first = FALSE;
+      }
+    fprintf(stderr,"}, \"tokens\": %ld, \"nodes\": %ld, \"symbols\": %ld, \"scopes\": %d",
+            tokenCount,nodeCount,nSymbols,nScopes);
+    for (e=0;e<nEvents;e++)
+      fprintf(stderr,", \"%s\": %ld",events[e].name,events[e].count);
+    fprintf(stderr,"}\n");
+    return;
+  }
+  fprintf(stderr,"\n%-12s %12s %12s\n","phase","wall ms","cpu ms");
+  for (p=0;p<PHASES;p++)
+    if (phases[p].runs > 0)
+    { fprintf(stderr,"%-12s %12.3f %12.3f\n",phaseName[p],
+              phases[p].wall * 1e3,phases[p].cpu * 1e3);
+      wall += phases[p].wall;
+      cpu += phases[p].cpu;
+    }
+  fprintf(stderr,"%-12s %12.3f %12.3f\n","total",wall * 1e3,cpu * 1e3);
+  fprintf(stderr,"\n%-12s %12ld\n%-12s %12ld\n%-12s %12ld\n%-12s %12d\n",
+          "tokens",tokenCount,"nodes",nodeCount,
+          "symbols",nSymbols,"scopes",nScopes);
+  for (e=0;e<nEvents;e++)
+    fprintf(stderr,"%-12s %12ld\n",events[e].name,events[e].count);
+}
+
+static char * memTagName[MEMTAGS] =
+   { "scan", "parse", "symtab", "analyze", "codegen", "other" };
+
+/* bytes requested and allocations made by each
+ * subsystem, updated atomically
+ */
+static struct
+   { long bytes, count;
+   } mem[MEMTAGS];
+
+static void charge(MemTag tag, size_t size)
+{ __atomic_fetch_add(&mem[tag].bytes,(long) size,__ATOMIC_RELAXED);
+  __atomic_fetch_add(&mem[tag].count,1,__ATOMIC_RELAXED);
+}
+
+void * tagAlloc(MemTag tag, size_t size)
+{ charge(tag,size);
+  return malloc(size);
+}
+
+void * tagCalloc(MemTag tag, size_t n, size_t size)
+{ charge(tag,n * size);
+  return calloc(n,size);
+}
+
+void * tagRealloc(MemTag tag, void * p, size_t size)
+{ charge(tag,size);
+  return realloc(p,size);
+}
+
+void printMemStats(void)
+{ struct rusage ru;
+  long bytes = 0, count = 0;
+  int t;
+  fprintf(stderr,"\n%-12s %14s %12s\n","subsystem","bytes","allocs");
+  for (t=0;t<MEMTAGS;t++)
+  { fprintf(stderr,"%-12s %14ld %12ld\n",memTagName[t],mem[t].bytes,mem[t].count);
+    bytes += mem[t].bytes;
+    count += mem[t].count;
+  }
+  fprintf(stderr,"%-12s %14ld %12ld\n","total",bytes,count);
+  getrusage(RUSAGE_SELF,&ru);
+  fprintf(stderr,"peak RSS     %11ld kB\n",ru.ru_maxrss);
+}
@@ -0,0 +1,64 @@
+/****************************************************/
+/* File: stats.h                                    */
+/* Phase timing and counters for the TINY compiler  */
+/****************************************************/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/* values of TimeReport */
+#define TIME_TABLE 1
+#define TIME_JSON 2
+
+/* the timed phases of a compilation */
+typedef enum
+   { ParsePhase,SymtabPhase,TypeCheckPhase,OptimizePhase,CodeGenPhase,PHASES }
+   Phase;
+
+/* tokens scanned and syntax tree nodes built */
+extern long tokenCount;
+extern long nodeCount;
+
+/* Procedures phaseBegin and phaseEnd delimit a run
+ * of phase p; the wall and CPU time of all runs add
+ * up. They do nothing unless TimeReport is set
+ */
+void phaseBegin(Phase p);
+void phaseEnd(Phase p);
+
+/* Procedure countEvent adds n to the counter
+ * name, which tells how often an optimization
+ * applied; printStats reports these counters
+ * after its own
+ */
+void countEvent(char * name, long n);
+
+/* the subsystems allocations are charged to */
+typedef enum
+   { ScanMem,ParseMem,SymtabMem,AnalyzeMem,CodeGenMem,OtherMem,MEMTAGS }
+   MemTag;
+
+/* Functions tagAlloc, tagCalloc and tagRealloc work
+ * as malloc, calloc and realloc, and charge the
+ * bytes requested to subsystem tag; a realloc is
+ * charged in full. They may be called from any
+ * thread
+ */
+void * tagAlloc(MemTag tag, size_t size);
+void * tagCalloc(MemTag tag, size_t n, size_t size);
+void * tagRealloc(MemTag tag, void * p, size_t size);
+
+/* Procedure printMemStats prints the bytes and the
+ * number of allocations of each subsystem and the
+ * peak resident set size to stderr; main registers
+ * it to run at exit
+ */
+void printMemStats(void);
+
+/* Procedure printStats prints the time of each phase
+ * that ran and the counters to stderr, as a table
+ * or as JSON according to TimeReport
+ */
+void printStats(void);
+
+#endif
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "symtab.h"
+#include "stats.h"
 
 /* SIZE is the size of the hash table */
 #define SIZE 211
@@ -66,9 +67,9 @@ void st_insert( char * name, int lineno, int loc )
   while ((l != NULL) && (strcmp(name,l->name) != 0))
     l = l->next;
   if (l == NULL) /* variable not yet in table */
-  { l = (BucketList) malloc(sizeof(struct BucketListRec));
+  { l = (BucketList) tagAlloc(SymtabMem,sizeof(struct BucketListRec));
     l->name = name;
-    l->lines = (LineList) malloc(sizeof(struct LineListRec));
+    l->lines = (LineList) tagAlloc(SymtabMem,sizeof(struct LineListRec));
     l->lines->lineno = lineno;
     l->memloc = loc;
     l->lines->next = NULL;
@@ -77,7 +78,7 @@ void st_insert( char * name, int lineno, int loc )
   else /* found in table, so just add line number */
   { LineList t = l->lines;
     while (t->next != NULL) t = t->next;
-    t->next = (LineList) malloc(sizeof(struct LineListRec));
+    t->next = (LineList) tagAlloc(SymtabMem,sizeof(struct LineListRec));
     t->next->lineno = lineno;
     t->next->next = NULL;
   }
@@ -95,6 +96,20 @@ int st_lookup ( char * name )
   else return l->memloc;
 }
 
+/* Function st_symbol_count returns the number of
+ * symbols in the table
+ */
+long st_symbol_count(void)
+{ long n = 0;
+  int i;
+  for (i=0;i<SIZE;++i)
+  { BucketList l;
+    for (l=hashTable[i];l!=NULL;l=l->next)
+      n++;
+  }
+  return n;
+}
+
 /* Procedure printSymTab prints a formatted 
  * listing of the symbol table contents 
  * to the listing file
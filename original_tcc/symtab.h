@@ -21,6 +21,11 @@ void st_insert( char * name, int lineno, int loc );
  */
 int st_lookup ( char * name );
 
+/* Function st_symbol_count returns the number of
+ * symbols in the table
+ */
+long st_symbol_count(void);
+
 /* Procedure printSymTab prints a formatted 
  * listing of the symbol table contents 
  * to the listing file
@@ -10,194 +10,240 @@
 #include "symtab.h"
 #include "analyze.h"
 #include "util.h"
+#include "parse.h"
+#include "workpool.h"
+#include "diag.h"
+#include "stats.h"
 
-static int unchangeScope = FALSE; 
+/* the analyzer state below is per thread, so that
+ * parallelAnalyze can check function bodies on
+ * several threads at once
+ */
+static __thread int unchangeScope = FALSE; 
+
+/* FALSE while only declarations are analyzed:
+ * function bodies skipped by a lazy parse stay
+ * unparsed
+ */
+static int parseBodies = TRUE;
 
-static ExpType retType = Void;
-static int isArray = FALSE; 
+static __thread ExpType retType = Void;
+static __thread int isArray = FALSE; 
 
 ScopeList globalScope = NULL;
 
-static int paramTypeStack[SIZE];
-static int paramTypeStackTop = 0;
-static int lastCallLineno = 0;
-
-static int printCallLineno = FALSE;
-
-/* Procedure traverse is a generic recursive 
- * syntax tree traversal routine:
- * it applies preProc in preorder and postProc 
- * in postorder to tree pointed to by t
- */
-static void traverse( TreeNode * t,
-               void (* preProc) (TreeNode *),
-               void (* postProc) (TreeNode *) )
-{ if (t != NULL)
-  { preProc(t);
-    { int i;
-      for (i=0; i < MAXCHILDREN; i++)
-        traverse(t->child[i],preProc,postProc);
-    }
-    postProc(t);
-    traverse(t->sibling,preProc,postProc);
+/* HeldError is a diagnostic printed later: a type
+ * error found by the fused pass, printed only if no
+ * symbol error occurred, or any error of a function
+ * checked by parallelAnalyze
+ */
+typedef struct
+   { int lineno;
+     char * message;
+     char * name; /* symbol errors only */
+   } HeldError;
+
+/* ErrorList is a growable list of held errors */
+typedef struct
+   { HeldError * errors;
+     int n, size;
+   } ErrorList;
+
+static void holdError(ErrorList * l, int lineno, char * message, char * name)
+{ if (l->n == l->size)
+  { l->size = l->size ? 2*l->size : 16;
+    l->errors = (HeldError *) tagRealloc(AnalyzeMem,l->errors,l->size * sizeof(HeldError));
   }
+  l->errors[l->n].lineno = lineno;
+  l->errors[l->n].message = message;
+  l->errors[l->n].name = name;
+  l->n++;
 }
 
-static void endInsertNode( TreeNode * t)
-{ if (t->nodekind == StmtK)
-  { if (t->kind.stmt == CompK)
-      del_cur_scope();
+/* TRUE while type errors are held back */
+static __thread int holdTypeErrors = FALSE;
+static __thread ErrorList heldErrors;
+
+/* FuncUnit is one top-level declaration analyzed
+ * by parallelAnalyze, with the diagnostics and
+ * symbol table changes it produced
+ */
+typedef struct
+   { TreeNode * decl;
+     BucketList bucket; /* its global symbol */
+     ScopeList scope;   /* scope of a function */
+     int visible;       /* global symbols it may see */
+     struct SymUnitRec sym;
+     ErrorList symbErrors;
+     ErrorList typeErrors;
+     SourceSpan span;   /* its text, in unitText */
+     int dirty;         /* to be checked again */
+     unsigned long bodyHash; /* hash of span, or 0 */
+     int copyOf;        /* unit it copies, or -1 */
+   } FuncUnit;
+
+/* the unit analyzed by this thread, if any */
+static __thread FuncUnit * curFunc = NULL;
+
+static void symbError(TreeNode * t, char * name, char * message)
+{ if (curFunc != NULL)
+  { holdError(&curFunc->symbErrors,t->lineno,message,name);
+    return;
   }
+  diagError(SymbolDiag,t->lineno,message,name);
 }
 
-static void symbError(TreeNode * t, char * name, char * message)
-{ fprintf(listing,"error: %s \"%s\" at line %d\n",message,name,t->lineno);
-  Error = TRUE;
-}
-
-/* Procedure insertNode inserts 
- * identifiers stored in t into 
- * the symbol table 
- */
-static void insertNode( TreeNode * t)
-{ switch (t->nodekind)
-  { case StmtK:
-      switch (t->kind.stmt)
-	  {	case VarK:
-		case ArrVarK:
-		// variable declarations
-		{ char * name;
-		  if (t->is_array)
-			name = t->attr.arr.name;
-	      else
-			name = t->attr.name;
-
-		  if (st_lookup_excluding_parent(name) != NULL)
-		  { symbError(t, name, "Undeclared variable");
-		    break;
-		  }
-
-		  if (t->var_type->type == Void)
-		  { symbError(t, name, "Variable type cannot be Void");
-		    break;
-		  }
-
-		  st_insert(name, t->var_type->type, t->lineno, get_location(), t->nodekind, t->kind.stmt, t->kind.exp);
-		}
-		break;
-
-		case ParamK:
-		case ArrParamK:
-		// function parameters
-		{ char * name;
-	      if (t->is_array)
-			name = t->attr.arr.name;
-		  else
-			name = t->attr.name;
-
-		  if (st_lookup(name) != NULL)
-		  { symbError(t, name, "Already declared variable");
-		    break;
-		  }
-
-		  if (t->var_type->type == Void)
-		  { symbError(t, name, "Parameter type cannot be Void");
-		    break;
-		  }
-
-		  st_insert(name, t->var_type->type, t->lineno, get_location(), t->nodekind, t->kind.stmt, t->kind.exp);
-		}
-		break;
-
-		case FuncK:
-		// function declarations
-		{ char * name = t->attr.name;
-		  if (st_lookup(name) != NULL)
-		  { symbError(t, name, "Undeclared function");
-		    break;
-		  }
-
-		  t->type = t->var_type->type;
-
-		  st_insert(name, t->var_type->type, t->lineno, get_location(), t->nodekind, t->kind.stmt, t->kind.exp);
-		  insert_scope(name);
-		  unchangeScope = TRUE;
-		}
-		break;
-
-		case CompK:
-		// compound statement(add scope)
-		{ char * name = get_cur_scope()->name;
-		  if (unchangeScope)
-			unchangeScope = FALSE;
-		  else
-		    insert_scope(name);
-		}
-		break;
-
-		case CallK:
-		// function call
-		{ char * name = t->attr.name;
-		  int lineno = t->lineno;
-		  BucketList find_bucket = st_lookup(name);
-		  ScopeList find_scope = NULL;
-		  if (find_bucket == NULL)
-		  {	symbError(t, name, "Undeclared call");
-			break;
-		  }
-
-		  t->type = find_bucket->type;
-
-		  find_scope = find_func_def_scope(name);
-		  if (find_scope == NULL)
-		  { symbError(t, name, "Undeclared call");
-		    break;
-		  }
-
-		  t->param_size = find_scope->param_size;
-		  t->param_list = find_scope->param_list;
-		  
-		  st_insert_lineno(find_bucket, lineno);
-		}
-		break;
-
-        default:
-          break;
-      }
-      break;
-    case ExpK:
-      switch (t->kind.exp)
-      { case IdK:
-		// load variable
-		{ char * name = t->attr.name;
-		  int lineno = t->lineno;
-		  BucketList find_bucket = st_lookup(name);
-		  if (find_bucket == NULL)
-		  { symbError(t, name, "Undeclared variable");
-		    break;
-		  }
-
-		  t->type = find_bucket->type;
-		  if (t->child[0] == NULL &&
-			  find_bucket->nodekind == StmtK &&
-			   (find_bucket->kind.stmt == ArrParamK ||
-			    find_bucket->kind.stmt == ArrVarK))
-		    t->is_array = TRUE;
-
-		  st_insert_lineno(find_bucket, lineno);
-		}
-		break;
-
-        default:
-          break;
-      }
-      break;
+/* insertVar inserts a variable declaration */
+static void insertVar( TreeNode * t)
+{ char * name;
+  if (t->is_array)
+	name = t->attr.arr.name;
+  else
+	name = t->attr.name;
 
-    default:
-      break;
+  if (st_lookup_excluding_parent(name) != NULL)
+  { symbError(t, name, "Undeclared variable");
+    return;
+  }
+
+  if (t->var_type == &voidTypeNode)
+  { symbError(t, name, "Variable type cannot be Void");
+    return;
+  }
+
+  t->symbol = st_insert(name, t->var_type->type, t->lineno,
+                        get_location(t->kind.stmt == ArrVarK ? t->attr.arr.size : 1),
+                        t->nodekind, t->kind.stmt, t->kind.exp);
+}
+
+/* insertParam inserts a function parameter */
+static void insertParam( TreeNode * t)
+{ char * name;
+  if (t->is_array)
+	name = t->attr.arr.name;
+  else
+	name = t->attr.name;
+
+  if (st_lookup(name) != NULL)
+  { symbError(t, name, "Already declared variable");
+    return;
+  }
+
+  if (t->var_type == &voidTypeNode)
+  { symbError(t, name, "Parameter type cannot be Void");
+    return;
   }
+
+  t->symbol = st_insert(name, t->var_type->type, t->lineno, get_location(1), t->nodekind, t->kind.stmt, t->kind.exp);
 }
 
+/* insertFunc inserts a function declaration and
+ * opens its scope, which its body shares
+ */
+static void insertFunc( TreeNode * t)
+{ char * name = t->attr.name;
+  if (t->lazy_body != NULL && parseBodies)
+    parseLazyBody(t);
+
+  if (st_lookup(name) != NULL)
+  { symbError(t, name, "Undeclared function");
+    return;
+  }
+
+  t->type = t->var_type->type;
+
+  /* a function takes no data memory */
+  t->symbol = st_insert(name, t->var_type->type, t->lineno, get_location(0), t->nodekind, t->kind.stmt, t->kind.exp);
+  insert_scope(name);
+  unchangeScope = TRUE;
+}
+
+/* insertComp opens the scope of a compound
+ * statement (a function body uses the function's)
+ */
+static void insertComp( TreeNode * t)
+{ char * name = get_cur_scope()->name;
+  if (unchangeScope)
+	unchangeScope = FALSE;
+  else
+    insert_scope(name);
+}
+
+/* insertCall resolves the function of a call */
+static void insertCall( TreeNode * t)
+{ char * name = t->attr.name;
+  int lineno = t->lineno;
+  BucketList find_bucket = st_lookup(name);
+  ScopeList find_scope = NULL;
+  if (find_bucket == NULL)
+  {	symbError(t, name, "Undeclared call");
+	return;
+  }
+
+  t->type = find_bucket->type;
+
+  find_scope = find_func_def_scope(name);
+  if (find_scope == NULL)
+  { symbError(t, name, "Undeclared call");
+    return;
+  }
+
+  t->param_size = find_scope->param_size;
+  t->param_list = find_scope->param_list;
+  t->symbol = find_bucket;
+  
+  st_insert_lineno(find_bucket, lineno);
+}
+
+/* insertId resolves a variable reference */
+static void insertId( TreeNode * t)
+{ char * name = t->attr.name;
+  int lineno = t->lineno;
+  BucketList find_bucket = st_lookup(name);
+  if (find_bucket == NULL)
+  { symbError(t, name, "Undeclared variable");
+    return;
+  }
+
+  t->type = find_bucket->type;
+  if (t->child[0] == NULL &&
+	  find_bucket->nodekind == StmtK &&
+	   (find_bucket->kind.stmt == ArrParamK ||
+	    find_bucket->kind.stmt == ArrVarK))
+    t->is_array = TRUE;
+  t->symbol = find_bucket;
+
+  st_insert_lineno(find_bucket, lineno);
+}
+
+/* closeComp closes the scope of a compound statement */
+static void closeComp( TreeNode * t)
+{ del_cur_scope();
+}
+
+/* closeFunc closes the scope of a function
+ * when no body closed it
+ */
+static void closeFunc( TreeNode * t)
+{ if (unchangeScope)
+  { del_cur_scope();
+    unchangeScope = FALSE;
+  }
+}
+
+/* insertNode inserts identifiers stored in
+ * a node into the symbol table, in preorder;
+ * endInsertNode closes scopes in postorder
+ */
+static const NodeProc insertNode[NODETYPES] =
+   { [VarT] = insertVar, [ArrVarT] = insertVar,
+     [ParamT] = insertParam, [ArrParamT] = insertParam,
+     [FuncT] = insertFunc, [CompT] = insertComp,
+     [CallT] = insertCall, [IdT] = insertId };
+
+static const NodeProc endInsertNode[NODETYPES] =
+   { [CompT] = closeComp, [FuncT] = closeFunc };
+
 void insert_input_func()
 { st_insert("input", Integer, 0, 0, StmtK, FuncK, UnknownK);
   insert_scope("input");
@@ -211,6 +257,23 @@ void insert_output_func()
   del_cur_scope();
 }
 
+/* traverseDecls traverses the declarations of the
+ * program one at a time, and stops when the error
+ * limit is reached
+ */
+static void traverseDecls(TreeNode * t, const NodeProc * preProc,
+                          const NodeProc * postProc)
+{ TreeNode * next;
+  while (t != NULL && !diagLimitReached())
+  { next = t->sibling;
+    t->sibling = NULL;
+    diagNextDecl();
+    traverseTree(t,preProc,postProc);
+    t->sibling = next;
+    t = next;
+  }
+}
+
 /* Function buildSymtab constructs the symbol 
  * table by preorder traversal of the syntax tree
  */
@@ -220,156 +283,776 @@ void buildSymtab(TreeNode * syntaxTree)
   insert_input_func();
   insert_output_func();
 
-  traverse(syntaxTree,insertNode,endInsertNode);
+  traverseDecls(syntaxTree,insertNode,endInsertNode);
+  del_cur_scope();
+  diagFlush();
+  if (TraceAnalyze && !Error)
+  { fprintf(listing,"\nSymbol table:\n\n");
+    printSymTab(listing);
+  }
+}
+
+/* Function buildGlobalSymtab constructs the symbol
+ * table of global declarations and function
+ * signatures only; function bodies skipped by a
+ * lazy parse are never parsed
+ */
+void buildGlobalSymtab(TreeNode * syntaxTree)
+{ parseBodies = FALSE;
+  insert_scope("global");
+  globalScope = get_cur_scope();
+  insert_input_func();
+  insert_output_func();
+
+  traverseDecls(syntaxTree,insertNode,endInsertNode);
   del_cur_scope();
+  diagFlush();
+  parseBodies = TRUE;
   if (TraceAnalyze && !Error)
   { fprintf(listing,"\nSymbol table:\n\n");
     printSymTab(listing);
   }
 }
 
+
 static void typeError(TreeNode * t, char * message)
-{ if (printCallLineno)
-	fprintf(listing,"Type error at line %d: %s\n",lastCallLineno,message);
+{ if (holdTypeErrors)
+  { holdError(&heldErrors,t->lineno,message,NULL);
+    return;
+  }
+  diagError(TypeDiag,t->lineno,message,NULL);
+}
+
+/* Function argsMatch returns TRUE if the argument
+ * list of call t matches the parameters of the
+ * callee: the same number of arguments, each an
+ * Integer and an array exactly where the parameter
+ * is one
+ */
+static int argsMatch(TreeNode * t)
+{ TreeNode * arg = t->child[0];
+  int i;
+  for (i = 0; i < t->param_size; i++, arg = arg->sibling)
+  { int kind;
+    if (arg == NULL || arg->type != Integer)
+      return FALSE;
+    kind = arg->is_array ? PARAMINTEGERARRAY : PARAMINTEGER;
+    if (t->param_list[i] != kind)
+      return FALSE;
+  }
+  return arg == NULL;
+}
+
+static void checkIf(TreeNode * t)
+{ if (t->child[0]->type == Void)
+    typeError(t, "invalid if condition");
+}
+
+static void checkWhile(TreeNode * t)
+{ if (t->child[0]->type == Void)
+    typeError(t, "invalid while condition");
+}
+
+static void checkFunc(TreeNode * t)
+{ if (t->type != retType || t->is_array != isArray)
+    typeError(t, "return type inconsistance");
+
+  retType = Void;
+  isArray = FALSE;
+}
+
+static void checkReturn(TreeNode * t)
+{ if (t->child[0] == NULL)
+    retType = Void;
+  else if (t->child[0]->type == Integer)
+  { retType = Integer;
+
+    if (t->child[0]->is_array)
+      isArray = TRUE;
+  }
   else
-	fprintf(listing,"Type error at line %d: %s\n",t->lineno,message);
+    retType = Void;
+}
+
+static void checkAssign(TreeNode * t)
+{ if (t->child[0]->type != t->child[1]->type || 
+      t->child[0]->is_array != t->child[1]->is_array)
+    typeError(t, "assign type inconsistance");
 
-  printCallLineno = FALSE;
-  Error = TRUE;
+  t->type = t->child[0]->type;
+  t->is_array = t->child[0]->is_array;
 }
 
-static void pullParamTypes(int pull_num)
-{ int i;
-  for (i = 0; i < paramTypeStackTop; i++)
-  { if (i < pull_num)
-      continue;
+static void checkCall(TreeNode * t)
+{ if (!argsMatch(t))
+    typeError(t, "invalid function call");
+}
+
+// I will set op result to integer (1: true | 0: false)
+static void checkOp(TreeNode * t)
+{ if (t->child[0]->type != t->child[1]->type ||
+      t->child[0]->is_array || t->child[1]->is_array)
+    typeError(t, "op type inconsistance");
+
+  t->type = Integer;
+  t->is_array = FALSE;
+}
 
-	paramTypeStack[i - pull_num] = paramTypeStack[i];
-  }
-}
-
-/* Procedure checkNode performs
- * type checking at a single tree node
- */
-static void checkNode(TreeNode * t)
-{ switch (t->nodekind) { 
-  case StmtK:
-    switch (t->kind.stmt) { 
-	  case IfK:
-	    if (t->child[0]->type == Void)
-		  typeError(t, "invalid if condition");
-	    break;
-
-	  case WhileK:
-	    if (t->child[0]->type == Void)
-		  typeError(t, "invalid while condition");
-		break;
-
-	  case FuncK:
-	    if (t->type != retType || t->is_array != isArray)
-		  typeError(t, "return type inconsistance");
-
-		retType = Void;
-		isArray = FALSE;
-	    break;
-
-	  case ReturnK:
-	    if (t->child[0] == NULL)
-		  retType = Void;
-		else if (t->child[0]->type == Integer)
-		{ retType = Integer;
-
-		  if (t->child[0]->is_array)
-		    isArray = TRUE;
-		}
-		else
-		  retType = Void;
-
-		break;
-
-	  case AssignK:
-	    if (t->child[0]->type != t->child[1]->type || 
-			t->child[0]->is_array != t->child[1]->is_array)
-		  typeError(t, "assign type inconsistance");
-
-		t->type = t->child[0]->type;
-		t->is_array = t->child[0]->is_array;
-	    break;
-
-	  case CallK:
-	  { int call_error = FALSE;
-		int i;
-		
-		if (lastCallLineno != t->lineno && paramTypeStackTop - t->param_size != 0)
-		{ lastCallLineno = t->lineno;
-		  typeError(t, "invalid function call");
-		  pullParamTypes(paramTypeStackTop - t->param_size);
-		  paramTypeStackTop = t->param_size;
-		  printCallLineno = TRUE;
-		}
-		else
-		  lastCallLineno = t->lineno;
-
-		for (i = t->param_size-1; i >= 0; i--)
-		{ paramTypeStackTop--;
-		  if (paramTypeStackTop < 0 || t->param_list[i] != paramTypeStack[paramTypeStackTop])
-		  { call_error = TRUE;
-			break;
-		  }
-		}
-
-		if (call_error)
-		  typeError(t, "invalid function call");
-
-		if (paramTypeStackTop < 0)
-		  paramTypeStackTop = 0;
-
-		if (t->is_argu)
-		  paramTypeStack[paramTypeStackTop++] = PARAMINTEGER;
-	  }
-	  break;
-	}
-	break;
-
-	case ExpK:
-	switch (t->kind.exp) {
-	  // I will set op result to integer (1: true | 0: false)
-	  case OpK:
-	    if (t->child[0]->type != t->child[1]->type ||
-			t->child[0]->is_array || t->child[1]->is_array)
-		  typeError(t, "op type inconsistance");
-
-		t->type = Integer;
-		t->is_array = FALSE;
-
-		if (t->is_argu)
-		  paramTypeStack[paramTypeStackTop++] = PARAMINTEGER;
-		break;
-
-	  case IdK:
-	    if (t->is_argu)
-		{ if (t->is_array)
-		    paramTypeStack[paramTypeStackTop++] = PARAMINTEGERARRAY;
-		  else
-			paramTypeStack[paramTypeStackTop++] = PARAMINTEGER;
-		}
-		break;
-
-	  case ConstK:
-	    t->type = Integer;
-		if (t->is_argu)
-	      paramTypeStack[paramTypeStackTop++] = PARAMINTEGER;
-		break;
-	}
-	break;
-  }
-}
-
-void nullProc() {}
+static void checkConst(TreeNode * t)
+{ t->type = Integer;
+}
+
+/* checkNode performs type checking at
+ * a single tree node, in postorder
+ */
+static const NodeProc checkNode[NODETYPES] =
+   { [IfT] = checkIf, [WhileT] = checkWhile,
+     [FuncT] = checkFunc, [ReturnT] = checkReturn,
+     [AssignT] = checkAssign, [CallT] = checkCall,
+     [OpT] = checkOp, [ConstT] = checkConst };
 
 /* Procedure typeCheck performs type checking 
  * by a postorder syntax tree traversal
  */
 void typeCheck(TreeNode * syntaxTree)
-{ traverse(syntaxTree,nullProc,checkNode);
+{ traverseDecls(syntaxTree,NULL,checkNode);
+  diagFlush();
+}
+
+static void checkCloseFunc(TreeNode * t)
+{ checkFunc(t);
+  closeFunc(t);
+}
+
+/* postorder step of the fused pass: a node is
+ * type checked before the scope it opened is
+ * closed
+ */
+static const NodeProc fusedPost[NODETYPES] =
+   { [IfT] = checkIf, [WhileT] = checkWhile,
+     [FuncT] = checkCloseFunc, [CompT] = closeComp,
+     [ReturnT] = checkReturn, [AssignT] = checkAssign,
+     [CallT] = checkCall, [OpT] = checkOp,
+     [ConstT] = checkConst };
+
+/* Procedure fusedAnalyze constructs the symbol table
+ * and type checks the syntax tree in one traversal.
+ * Type errors are held back, since buildSymtab and
+ * typeCheck would not check types after a symbol
+ * error; typeCheckReport prints them
+ */
+void fusedAnalyze(TreeNode * syntaxTree)
+{ st_reset();
+  insert_scope("global");
+  globalScope = get_cur_scope();
+  insert_input_func();
+  insert_output_func();
+
+  heldErrors.n = 0;
+  holdTypeErrors = TRUE;
+  traverseDecls(syntaxTree,insertNode,fusedPost);
+  holdTypeErrors = FALSE;
+  del_cur_scope();
+  diagFlush();
+  if (TraceAnalyze && !Error)
+  { fprintf(listing,"\nSymbol table:\n\n");
+    printSymTab(listing);
+  }
+}
+
+/* Procedure typeCheckReport prints the type errors
+ * held back by fusedAnalyze
+ */
+void typeCheckReport(void)
+{ int i;
+  for (i=0;i<heldErrors.n;i++)
+    diagError(TypeDiag,heldErrors.errors[i].lineno,
+              heldErrors.errors[i].message,NULL);
+  heldErrors.n = 0;
+  diagFlush();
+}
+
+static char * declName(TreeNode * t)
+{ return t->is_array ? t->attr.arr.name : t->attr.name;
+}
+
+static int compareNames(const void * a, const void * b)
+{ return strcmp(*(char * const *) a,*(char * const *) b);
+}
+
+/* Function checkGlobals returns TRUE if the global
+ * declarations of the program are free of symbol
+ * errors: no name is declared twice and no variable
+ * is Void
+ */
+static int checkGlobals(TreeNode * syntaxTree, int n)
+{ char ** names = (char **) tagAlloc(AnalyzeMem,(n+2) * sizeof(char *));
+  TreeNode * t;
+  int i, ok = TRUE;
+  names[0] = "input";
+  names[1] = "output";
+  for (t=syntaxTree,i=2;t!=NULL;t=t->sibling,i++)
+  { names[i] = declName(t);
+    if (t->kind.stmt != FuncK && t->var_type == &voidTypeNode)
+      ok = FALSE;
+  }
+  qsort(names,n+2,sizeof(char *),compareNames);
+  for (i=1;i<n+2;i++)
+    if (strcmp(names[i-1],names[i]) == 0)
+      ok = FALSE;
+  free(names);
+  return ok;
+}
+
+/* checkFunction is the task that builds the local
+ * scopes of one function body and type checks it
+ */
+static void checkFunction(int task, void * arg)
+{ FuncUnit * u = ((FuncUnit **) arg)[task];
+  TreeNode * t = u->decl;
+  curFunc = u;
+  st_begin_unit(&u->sym,u->scope,u->visible);
+  /* nothing is kept from the last check on this
+   * thread: the type errors it held were not
+   * reported if a symbol error hid them
+   */
+  retType = Void;
+  isArray = FALSE;
+  free(heldErrors.errors);
+  heldErrors = u->typeErrors;
+  heldErrors.n = 0;
+  holdTypeErrors = TRUE;
+  unchangeScope = TRUE;
+  traverseTree(t->child[1],insertNode,fusedPost);
+  checkFunc(t);
+  unchangeScope = FALSE;
+  holdTypeErrors = FALSE;
+  u->typeErrors = heldErrors;
+  heldErrors.errors = NULL;
+  heldErrors.n = heldErrors.size = 0;
+  st_end_unit();
+  curFunc = NULL;
+}
+
+/* the units of the last parallel analysis, one per
+ * top-level declaration, kept for incrementalAnalyze
+ */
+static FuncUnit * units = NULL;
+static int nUnits = 0;
+
+/* the source text of the units, if known */
+static char * unitText = NULL;
+
+/* the syntax tree incrementalAnalyze returned last */
+static TreeNode * lastTree = NULL;
+
+/* the trees and declarations incrementalAnalyze
+ * dropped, left for freeDropped
+ */
+static TreeNode * droppedTree = NULL;
+static TreeNode * dropped = NULL;
+
+/* scopes in the table before those of the units */
+static int baseScopes = 0;
+
+/* the dependency graph: the units referencing the
+ * global symbol declared i-th are depUnits[j] for
+ * depStart[i] <= j < depStart[i+1]
+ */
+static int * depStart = NULL;
+static int * depUnits = NULL;
+
+static void freeUnits(void)
+{ int i;
+  for (i=0;i<nUnits;i++)
+  { st_free_unit(&units[i].sym);
+    free(units[i].symbErrors.errors);
+    free(units[i].typeErrors.errors);
+  }
+  free(units);
+  units = NULL;
+  nUnits = 0;
+}
+
+static unsigned long declHash(TreeNode * t)
+{ unsigned long h = hashNode(t);
+  if (t->kind.stmt == FuncK)
+    h = h * 31 + hashTree(t->child[0]);
+  return h;
+}
+
+/* enterDecl enters the declaration of unit u into
+ * the global scope, and the parameters of a
+ * function into the function's scope
+ */
+static void enterDecl(FuncUnit * u)
+{ TreeNode * t = u->decl;
+  curFunc = u;
+  st_collect(&u->sym);
+  visitNode(insertNode,t);
+  u->bucket = st_lookup(declName(t));
+  if (t->kind.stmt == FuncK)
+  { traverseTree(t->child[0],insertNode,endInsertNode);
+    u->scope = get_cur_scope();
+    u->visible = st_global_count();
+    del_cur_scope();
+    unchangeScope = FALSE;
+  }
+  st_collect(NULL);
+  curFunc = NULL;
+}
+
+/* reenterDecl updates the global symbol of unit u
+ * to its changed declaration, and builds the scope
+ * and parameters of a function again
+ */
+static void reenterDecl(FuncUnit * u)
+{ TreeNode * t = u->decl;
+  int i;
+  for (i=0;i<u->sym.nRefs;i++)
+  { st_reset_lines(u->sym.refBuckets[i]);
+    st_trim_lines(u->sym.refBuckets[i]);
+  }
+  st_clear_unit(&u->sym);
+  u->bucket->name = declName(t);
+  u->bucket->lines->lineno = t->lineno;
+  u->symbErrors.n = 0;
+  u->typeErrors.n = 0;
+  u->bucket->kind.stmt = t->kind.stmt;
+  if (t->kind.stmt == FuncK)
+  { curFunc = u;
+    st_begin_global(&u->sym);
+    t->type = t->var_type->type;
+    u->bucket->type = t->type;
+    u->bucket->func_scope = NULL;
+    insert_scope(t->attr.name);
+    traverseTree(t->child[0],insertNode,endInsertNode);
+    u->scope = get_cur_scope();
+    st_end_unit();
+    curFunc = NULL;
+  }
+}
+
+static int shiftDelta;
+
+static void shiftNode(TreeNode * t)
+{ t->lineno += shiftDelta;
+}
+
+static const NodeProc shiftVisitor[NODETYPES] = EVERYNODE(shiftNode);
+
+/* shiftUnit moves unit u, whose declaration is
+ * unchanged but now starts delta lines later, to
+ * its new place
+ */
+static void shiftUnit(FuncUnit * u, int delta)
+{ TreeNode * next = u->decl->sibling;
+  int i;
+  shiftDelta = delta;
+  u->decl->sibling = NULL;
+  traverseTree(u->decl,shiftVisitor,NULL);
+  u->decl->sibling = next;
+  u->bucket->lines->lineno = u->decl->lineno;
+  st_shift_unit(&u->sym,delta);
+  for (i=0;i<u->symbErrors.n;i++)
+    u->symbErrors.errors[i].lineno += delta;
+  for (i=0;i<u->typeErrors.n;i++)
+    u->typeErrors.errors[i].lineno += delta;
+}
+
+/* line distance between the functions compared */
+static int lineDelta;
+
+/* copyTypes gives node b, if it is a copy of node a
+ * lineDelta lines later, the types the analysis
+ * found for node a, and tells whether it is
+ */
+static int copyTypes(TreeNode * a, TreeNode * b)
+{ int same;
+  if (nodeType(a) != nodeType(b) || b->lineno - a->lineno != lineDelta)
+    return FALSE;
+  /* parameters keep their own symbols */
+  if (nodeType(a) != ParamT && nodeType(a) != ArrParamT)
+    b->symbol = a->symbol;
+  switch (nodeType(a))
+  { case VarT: case ParamT:
+      return a->var_type == b->var_type &&
+             strcmp(a->attr.name,b->attr.name) == 0;
+    case ArrVarT: case ArrParamT:
+      return a->var_type == b->var_type &&
+             strcmp(a->attr.arr.name,b->attr.arr.name) == 0 &&
+             a->attr.arr.size == b->attr.arr.size;
+    case CallT: case IdT:
+      same = strcmp(a->attr.name,b->attr.name) == 0;
+      break;
+    case OpT:
+      same = a->attr.op == b->attr.op;
+      break;
+    case ConstT:
+      same = a->attr.val == b->attr.val;
+      break;
+    default:
+      same = TRUE;
+      break;
+  }
+  b->type = a->type;
+  b->is_array = a->is_array;
+  b->param_size = a->param_size;
+  b->param_list = a->param_list;
+  return same;
+}
+
+/* clearTypes undoes copyTypes on node t */
+static void clearTypes(TreeNode * t)
+{ switch (nodeType(t))
+  { case ParamT: case ArrParamT:
+      break;
+    case VarT: case ArrVarT:
+      t->symbol = NULL;
+      break;
+    default:
+      t->type = Void;
+      t->is_array = FALSE;
+      t->param_size = 0;
+      t->param_list = NULL;
+      t->symbol = NULL;
+      break;
+  }
+}
+
+static const NodeProc clearVisitor[NODETYPES] = EVERYNODE(clearTypes);
+
+/* the local symbols of the unit being copied */
+static BucketList * copyLocals;
+
+/* remapSymbol makes node t, which copyTypes gave
+ * a local symbol of the checked unit, refer to the
+ * copy of that symbol, which a declaration names
+ * after itself, since the tree of the checked unit
+ * may be freed first
+ */
+static void remapSymbol(TreeNode * t)
+{ if (t->symbol != NULL && t->symbol->local_order >= 0)
+  { t->symbol = copyLocals[t->symbol->local_order];
+    if (nodeType(t) == VarT || nodeType(t) == ArrVarT)
+      t->symbol->name = declName(t);
+  }
+}
+
+static const NodeProc remapVisitor[NODETYPES] = EVERYNODE(remapSymbol);
+
+/* copyUnit gives unit d the scopes, references,
+ * types and type errors found for the checked unit
+ * r, if their functions differ only in their names
+ * and lines, and tells whether they do
+ */
+static int copyUnit(FuncUnit * r, FuncUnit * d)
+{ TreeNode * a = r->decl, * b = d->decl;
+  int i;
+  lineDelta = b->lineno - a->lineno;
+  if (a->var_type != b->var_type ||
+      !pairTrees(a->child[0],b->child[0],copyTypes))
+    return FALSE;
+  if (!pairTrees(a->child[1],b->child[1],copyTypes))
+  { traverseTree(b->child[1],clearVisitor,NULL);
+    return FALSE;
+  }
+  st_copy_unit(&d->sym,&r->sym,lineDelta);
+  copyLocals = d->sym.locals;
+  traverseTree(b->child[1],remapVisitor,NULL);
+  d->typeErrors.n = 0;
+  for (i=0;i<r->typeErrors.n;i++)
+    holdError(&d->typeErrors,r->typeErrors.errors[i].lineno + lineDelta,
+              r->typeErrors.errors[i].message,NULL);
+  return TRUE;
+}
+
+/* runUnits checks the bodies of the dirty function
+ * units on nThreads threads and returns their number.
+ * Functions are looked up by the hash of their text
+ * without the name: a dirty function whose body is
+ * that of an earlier function is not checked but
+ * copies its results, unless a symbol error may
+ * depend on the globals visible at either place
+ */
+static int runUnits(int nThreads)
+{ FuncUnit ** work = (FuncUnit **) tagAlloc(AnalyzeMem,nUnits * sizeof(FuncUnit *));
+  int * first, size = 2, i, j, nWork = 0, nChecked;
+  while (size < 2*nUnits)
+    size *= 2;
+  /* open hash table of the first function unit
+   * with each body hash
+   */
+  first = (int *) tagAlloc(AnalyzeMem,size * sizeof(int));
+  for (j=0;j<size;j++)
+    first[j] = -1;
+  for (i=0;i<nUnits;i++)
+  { FuncUnit * u = &units[i];
+    u->copyOf = -1;
+    if (u->decl->kind.stmt != FuncK || u->bodyHash == 0)
+    { if (u->dirty && u->decl->kind.stmt == FuncK)
+        work[nWork++] = u;
+      u->dirty = FALSE;
+      continue;
+    }
+    j = (int) (u->bodyHash & (size-1));
+    while (first[j] >= 0 && units[first[j]].bodyHash != u->bodyHash)
+      j = (j+1) & (size-1);
+    if (first[j] < 0)
+      first[j] = i;
+    else if (u->dirty)
+      u->copyOf = first[j];
+    if (u->dirty && u->copyOf < 0)
+      work[nWork++] = u;
+    u->dirty = FALSE;
+  }
+  free(first);
+  runTasks(nWork,nThreads,checkFunction,work);
+  nChecked = nWork;
+  nWork = 0;
+  for (i=0;i<nUnits;i++)
+  { FuncUnit * u = &units[i];
+    if (u->copyOf < 0)
+      continue;
+    if (units[u->copyOf].symbErrors.n != 0 || u->symbErrors.n != 0 ||
+        !copyUnit(&units[u->copyOf],u))
+      work[nWork++] = u;
+  }
+  runTasks(nWork,nThreads,checkFunction,work);
+  free(work);
+  return nChecked + nWork;
+}
+
+/* mergeUnits rebuilds the scope table, the lines
+ * of global symbols and the dependency graph from
+ * the units, in source order, prints their symbol
+ * errors and holds their type errors
+ */
+static void mergeUnits(void)
+{ int nGlobals = st_global_count();
+  int i, j, nDeps = 0;
+  st_truncate_scopes(baseScopes);
+  for (i=0;i<nUnits;i++)
+    for (j=0;j<units[i].sym.nRefs;j++)
+      st_reset_lines(units[i].sym.refBuckets[j]);
+
+  free(depStart);
+  free(depUnits);
+  depStart = (int *) tagCalloc(AnalyzeMem,nGlobals+1,sizeof(int));
+  heldErrors.n = 0;
+  for (i=0;i<nUnits;i++)
+  { FuncUnit * u = &units[i];
+    diagNextDecl();
+    for (j=0;j<u->symbErrors.n;j++)
+    { HeldError * e = &u->symbErrors.errors[j];
+      diagError(SymbolDiag,e->lineno,e->message,e->name);
+    }
+    st_merge_unit(&u->sym);
+    for (j=0;j<u->typeErrors.n;j++)
+    { HeldError * e = &u->typeErrors.errors[j];
+      holdError(&heldErrors,e->lineno,e->message,NULL);
+    }
+    for (j=0;j<u->sym.nRefs;j++)
+      depStart[u->sym.refBuckets[j]->global_order+1]++;
+    nDeps += u->sym.nRefs;
+  }
+  for (i=0;i<nUnits;i++)
+    for (j=0;j<units[i].sym.nRefs;j++)
+      st_trim_lines(units[i].sym.refBuckets[j]);
+  for (i=0;i<nGlobals;i++)
+    depStart[i+1] += depStart[i];
+  depUnits = (int *) tagAlloc(AnalyzeMem,(nDeps+1) * sizeof(int));
+  { int * fill = (int *) tagAlloc(AnalyzeMem,(nGlobals+1) * sizeof(int));
+    memcpy(fill,depStart,(nGlobals+1) * sizeof(int));
+    for (i=0;i<nUnits;i++)
+      for (j=0;j<units[i].sym.nRefs;j++)
+        depUnits[fill[units[i].sym.refBuckets[j]->global_order]++] = i;
+    free(fill);
+  }
+  diagFlush();
+}
+
+/* Procedure parallelAnalyze does the work of
+ * fusedAnalyze with the function bodies checked
+ * on nThreads threads. Global declarations and
+ * parameters are entered first, in source order;
+ * each body then sees only the globals declared
+ * before it, and its diagnostics, scopes and
+ * global references are merged in source order,
+ * so the output is that of fusedAnalyze
+ */
+void parallelAnalyze(TreeNode * syntaxTree, int nThreads)
+{ TreeNode * t;
+  SourceSpan * spans;
+  int n = 0, nSpans, i;
+  freeUnits();
+  for (t=syntaxTree;t!=NULL;t=t->sibling)
+    n++;
+  /* a global symbol error changes the scopes seen
+   * by later declarations; leave it to one thread
+   */
+  if (!checkGlobals(syntaxTree,n))
+  { fusedAnalyze(syntaxTree);
+    return;
+  }
+  units = (FuncUnit *) tagCalloc(AnalyzeMem,n,sizeof(FuncUnit));
+  nUnits = n;
+
+  st_reset();
+  insert_scope("global");
+  globalScope = get_cur_scope();
+  insert_input_func();
+  insert_output_func();
+  baseScopes = st_scope_count();
+
+  spans = declSpans(&nSpans);
+  for (t=syntaxTree,i=0;t!=NULL;t=t->sibling,i++)
+  { units[i].decl = t;
+    units[i].dirty = TRUE;
+    units[i].bodyHash = nSpans == n ? spans[i].hash : 0;
+    enterDecl(&units[i]);
+  }
+  del_cur_scope();
+
+  runUnits(nThreads);
+  mergeUnits();
+  if (TraceAnalyze && !Error)
+  { fprintf(listing,"\nSymbol table:\n\n");
+    printSymTab(listing);
+  }
+}
+
+/* dropDecl leaves declaration t, not its siblings,
+ * to be freed by freeDropped
+ */
+static void dropDecl(TreeNode * t)
+{ t->sibling = dropped;
+  dropped = t;
+}
+
+/* Procedure freeDropped frees what the last call of
+ * incrementalAnalyze dropped of both trees
+ */
+void freeDropped(void)
+{ freeTree(droppedTree);
+  droppedTree = NULL;
+  freeTree(dropped);
+  dropped = NULL;
+}
+
+/* sameText tells whether the declaration of unit u
+ * has the same text in the new source text
+ */
+static int sameText(FuncUnit * u, char * text, SourceSpan * span)
+{ long len = span->end - span->start;
+  return len == u->span.end - u->span.start &&
+         memcmp(text + span->start,unitText + u->span.start,len) == 0;
+}
+
+/* Function incrementalAnalyze does the work of
+ * parallelAnalyze for a new version of the program
+ * analyzed last; text is its source text, which is
+ * kept until the next call. When each declaration
+ * whose text changed still declares the same name,
+ * only the functions that changed and the functions
+ * using a global whose declaration changed are
+ * checked again; the other units and subtrees are
+ * reused and moved to their new lines. Otherwise
+ * the whole program is analyzed. It returns the
+ * syntax tree, which shares the unchanged subtrees
+ * of the last version, and puts the number of
+ * functions checked in rechecked; the rest of both
+ * trees is left to freeDropped, so that freeing it
+ * is not part of the check. The symbol table is not
+ * printed
+ */
+TreeNode * incrementalAnalyze(TreeNode * syntaxTree, char * text, int nThreads, int * rechecked)
+{ TreeNode * t, * prev = NULL;
+  SourceSpan * spans;
+  char * same = NULL;
+  int n = 0, nSpans, i, j, full;
+  for (t=syntaxTree;t!=NULL;t=t->sibling)
+    n++;
+  spans = declSpans(&nSpans);
+  full = units == NULL || unitText == NULL || n != nUnits || nSpans != n;
+  if (!full)
+  { same = (char *) tagAlloc(AnalyzeMem,n);
+    for (t=syntaxTree,i=0;t!=NULL && !full;t=t->sibling,i++)
+    { same[i] = sameText(&units[i],text,&spans[i]);
+      if (!same[i] &&
+          ((t->kind.stmt == FuncK) != (units[i].decl->kind.stmt == FuncK) ||
+           strcmp(declName(t),declName(units[i].decl)) != 0 ||
+           (t->kind.stmt != FuncK && t->var_type == &voidTypeNode)))
+        full = TRUE;
+    }
+  }
+  free(unitText);
+  unitText = text;
+  if (full)
+  { int savedTrace = TraceAnalyze;
+    free(same);
+    freeDropped();
+    droppedTree = lastTree;
+    lastTree = syntaxTree;
+    TraceAnalyze = FALSE;
+    parallelAnalyze(syntaxTree,nThreads);
+    TraceAnalyze = savedTrace;
+    *rechecked = 0;
+    for (t=syntaxTree;t!=NULL;t=t->sibling)
+      if (t->kind.stmt == FuncK)
+        (*rechecked)++;
+    if (units == NULL || nSpans != nUnits)
+    { free(unitText);
+      unitText = NULL;
+    }
+    else
+      for (i=0;i<nUnits;i++)
+        units[i].span = spans[i];
+    return syntaxTree;
+  }
+
+  for (t=syntaxTree,i=0;t!=NULL;prev=t,t=t->sibling,i++)
+  { FuncUnit * u = &units[i];
+    /* new text may only move lines, so the unit is
+     * checked again, but its users only if the
+     * declaration itself changed
+     */
+    if (!same[i])
+    { if (declHash(t) != declHash(u->decl))
+        for (j=depStart[u->bucket->global_order];j<depStart[u->bucket->global_order+1];j++)
+          units[depUnits[j]].dirty = TRUE;
+      u->dirty = TRUE;
+    }
+    if (!same[i] || u->dirty)
+    { dropDecl(u->decl);
+      u->decl = t;
+    }
+    else
+    { /* reuse the analyzed subtree in the new tree */
+      TreeNode * old = u->decl;
+      if (spans[i].lineno != u->span.lineno)
+        shiftUnit(u,spans[i].lineno - u->span.lineno);
+      old->sibling = t->sibling;
+      if (prev == NULL)
+        syntaxTree = old;
+      else
+        prev->sibling = old;
+      dropDecl(t);
+      t = old;
+    }
+    u->span = spans[i];
+    u->bodyHash = spans[i].hash;
+  }
+  free(same);
+  /* a dependent marked after its own turn above
+   * keeps its old subtree, whose text is the same
+   */
+  for (i=0;i<nUnits;i++)
+    if (units[i].dirty)
+      reenterDecl(&units[i]);
+
+  *rechecked = runUnits(nThreads);
+  mergeUnits();
+  lastTree = syntaxTree;
+  return syntaxTree;
 }
@@ -13,9 +13,50 @@
  */
 void buildSymtab(TreeNode *);
 
+/* Function buildGlobalSymtab constructs the symbol
+ * table of global declarations and function
+ * signatures only; function bodies skipped by a
+ * lazy parse are never parsed
+ */
+void buildGlobalSymtab(TreeNode *);
+
 /* Procedure typeCheck performs type checking 
  * by a postorder syntax tree traversal
  */
 void typeCheck(TreeNode *);
 
+/* Procedure fusedAnalyze constructs the symbol table
+ * and type checks the syntax tree in one traversal;
+ * type errors are held until typeCheckReport
+ */
+void fusedAnalyze(TreeNode *);
+
+/* Procedure parallelAnalyze does the work of
+ * fusedAnalyze with the function bodies checked
+ * on nThreads threads; the output is the same
+ */
+void parallelAnalyze(TreeNode *, int nThreads);
+
+/* Function incrementalAnalyze does the work of
+ * parallelAnalyze for a new version of the program
+ * analyzed last, whose source text is text, checking
+ * again only the functions that changed or use a
+ * global that changed. The text is kept until the
+ * next call. It returns the syntax tree to use,
+ * which shares the unchanged subtrees of the last
+ * version, and puts the number of functions checked
+ * in rechecked. The symbol table is not printed
+ */
+TreeNode * incrementalAnalyze(TreeNode *, char * text, int nThreads, int * rechecked);
+
+/* Procedure freeDropped frees the parts of the old
+ * and new trees the last incrementalAnalyze dropped
+ */
+void freeDropped(void);
+
+/* Procedure typeCheckReport prints the type errors
+ * held back by fusedAnalyze
+ */
+void typeCheckReport(void);
+
 #endif
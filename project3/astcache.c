@@ -0,0 +1,451 @@
+/****************************************************/
+/* File: astcache.c                                 */
+/* Binary syntax tree cache implementation          */
+/* for the C-minus compiler                         */
+/* Trees are stored in a compact pre-order stream,  */
+/* one file per source text, named after a 64-bit   */
+/* FNV-1a hash of the source bytes                  */
+/****************************************************/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "globals.h"
+#include "util.h"
+#include "parse.h"
+#include "pushscan.h"
+#include "astcache.h"
+#include "stats.h"
+
+#define CACHE_MAGIC "CMAST"
+#define CACHE_MAGIC_LEN 5
+#define CACHE_VERSION 1
+
+/* bits of the per-node flag byte */
+#define F_ARRAY    0x01
+#define F_ARGU     0x02
+#define F_VARTYPE  0x04
+#define F_INTEGER  0x08 /* var_type == &intTypeNode */
+#define F_CHILD0   0x10 /* F_CHILD0 << i: child[i] follows */
+#define F_SIBLING  0x80 /* a sibling node follows the subtree */
+
+/* size of the string interning hash table */
+#define STRHASH 257
+
+/* growable output byte buffer */
+typedef struct
+   { unsigned char * buf;
+     long len, cap;
+   } OutBuf;
+
+/* input cursor over a cache file image */
+typedef struct
+   { const unsigned char * p;
+     const unsigned char * end;
+     int bad;
+   } InBuf;
+
+/* interned string record for the writer */
+typedef struct StrRec
+   { char * s;
+     int idx;
+     struct StrRec * next;
+   } StrRec;
+
+static StrRec * strTable[STRHASH];
+static int nStrings = 0;
+
+/* strings already read, indexed by order of appearance */
+static char ** readStrings = NULL;
+static int nReadStrings = 0, capReadStrings = 0;
+
+/* the hash function used for source texts */
+static unsigned long long fnv1a(const char * s, long len)
+{ unsigned long long h = 14695981039346656037ULL;
+  long i;
+  for (i=0;i<len;i++)
+  { h ^= (unsigned char) s[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static int strHash(const char * s)
+{ unsigned h = 0;
+  while (*s) h = (h << 4) + (unsigned char) *s++;
+  return h % STRHASH;
+}
+
+/**************************************************/
+/*************   Writing the stream   *************/
+/**************************************************/
+
+static void putByte(OutBuf * o, int c)
+{ if (o->len == o->cap)
+  { o->cap = o->cap ? o->cap * 2 : 4096;
+    o->buf = (unsigned char *) tagRealloc(CacheMem,o->buf,o->cap);
+  }
+  o->buf[o->len++] = (unsigned char) c;
+}
+
+/* unsigned LEB128 */
+static void putUint(OutBuf * o, unsigned long v)
+{ while (v >= 0x80)
+  { putByte(o,(int)(v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  putByte(o,(int) v);
+}
+
+/* zigzag-encoded signed value */
+static void putInt(OutBuf * o, long v)
+{ putUint(o,((unsigned long) v << 1) ^ (unsigned long)(v >> (sizeof(long)*8-1)));
+}
+
+/* strings are written once; repeats refer
+ * to the index of the first occurrence
+ */
+static void putString(OutBuf * o, char * s)
+{ int h;
+  StrRec * r;
+  long n, i;
+  if (s == NULL)
+  { putUint(o,0);
+    return;
+  }
+  h = strHash(s);
+  for (r = strTable[h]; r != NULL; r = r->next)
+    if (strcmp(r->s,s) == 0)
+    { putUint(o,r->idx + 2);
+      return;
+    }
+  r = (StrRec *) tagAlloc(CacheMem,sizeof(StrRec));
+  r->s = s;
+  r->idx = nStrings++;
+  r->next = strTable[h];
+  strTable[h] = r;
+  n = strlen(s);
+  putUint(o,1);
+  putUint(o,n);
+  for (i=0;i<n;i++) putByte(o,s[i]);
+}
+
+static void freeStrTable(void)
+{ int i;
+  for (i=0;i<STRHASH;i++)
+  { while (strTable[i] != NULL)
+    { StrRec * r = strTable[i];
+      strTable[i] = r->next;
+      free(r);
+    }
+  }
+  nStrings = 0;
+}
+
+/* the attr member in use depends on the node kind */
+static int hasName(TreeNode * t)
+{ if (t->nodekind == StmtK)
+    return t->kind.stmt == VarK || t->kind.stmt == ParamK ||
+           t->kind.stmt == FuncK || t->kind.stmt == CallK;
+  return t->kind.exp == IdK;
+}
+
+static int hasArr(TreeNode * t)
+{ return t->nodekind == StmtK &&
+         (t->kind.stmt == ArrVarK || t->kind.stmt == ArrParamK);
+}
+
+static int hasVarType(TreeNode * t)
+{ return t->nodekind == StmtK &&
+         (t->kind.stmt == VarK || t->kind.stmt == ArrVarK ||
+          t->kind.stmt == ParamK || t->kind.stmt == ArrParamK ||
+          t->kind.stmt == FuncK);
+}
+
+static int lastLineno = 0;
+
+/* writes t, its subtrees and its siblings */
+static void writeTree(OutBuf * o, TreeNode * t)
+{ while (t != NULL)
+  { int flags = 0, i;
+    if (t->is_array) flags |= F_ARRAY;
+    if (t->is_argu) flags |= F_ARGU;
+    if (hasVarType(t) && t->var_type != NULL)
+    { flags |= F_VARTYPE;
+      if (t->var_type == &intTypeNode) flags |= F_INTEGER;
+    }
+    for (i=0;i<MAXCHILDREN;i++)
+      if (t->child[i] != NULL) flags |= F_CHILD0 << i;
+    if (t->sibling != NULL) flags |= F_SIBLING;
+
+    if (t->nodekind == StmtK)
+      putByte(o,t->kind.stmt);
+    else
+      putByte(o,0x40 | t->kind.exp);
+    putByte(o,flags);
+    putInt(o,t->lineno - lastLineno);
+    lastLineno = t->lineno;
+
+    if (hasName(t))
+      putString(o,t->attr.name);
+    else if (hasArr(t))
+    { putString(o,t->attr.arr.name);
+      putInt(o,t->attr.arr.size);
+    }
+    else if (t->nodekind == ExpK && t->kind.exp == OpK)
+      putInt(o,t->attr.op);
+    else if (t->nodekind == ExpK && t->kind.exp == ConstK)
+      putInt(o,t->attr.val);
+
+    for (i=0;i<MAXCHILDREN;i++)
+      if (t->child[i] != NULL)
+        writeTree(o,t->child[i]);
+    t = t->sibling;
+  }
+}
+
+/**************************************************/
+/*************   Reading the stream   *************/
+/**************************************************/
+
+static int getByte(InBuf * in)
+{ if (in->p >= in->end)
+  { in->bad = TRUE;
+    return 0;
+  }
+  return *in->p++;
+}
+
+static unsigned long getUint(InBuf * in)
+{ unsigned long v = 0;
+  int shift = 0, c;
+  do
+  { c = getByte(in);
+    if (shift < (int)(sizeof(long)*8)) v |= (unsigned long)(c & 0x7f) << shift;
+    shift += 7;
+  } while ((c & 0x80) && !in->bad);
+  return v;
+}
+
+static long getInt(InBuf * in)
+{ unsigned long v = getUint(in);
+  return (long)(v >> 1) ^ -(long)(v & 1);
+}
+
+static char * getString(InBuf * in)
+{ unsigned long tag = getUint(in);
+  unsigned long n;
+  char * s;
+  if (tag == 0) return NULL;
+  if (tag >= 2)
+  { if (tag - 2 >= (unsigned long) nReadStrings)
+    { in->bad = TRUE;
+      return NULL;
+    }
+    return readStrings[tag - 2];
+  }
+  n = getUint(in);
+  if (n > (unsigned long)(in->end - in->p))
+  { in->bad = TRUE;
+    return NULL;
+  }
+  s = (char *) tagAlloc(CacheMem,n+1);
+  memcpy(s,in->p,n);
+  s[n] = '\0';
+  in->p += n;
+  if (nReadStrings == capReadStrings)
+  { capReadStrings = capReadStrings ? capReadStrings * 2 : 64;
+    readStrings = (char **) tagRealloc(CacheMem,readStrings,capReadStrings * sizeof(char *));
+  }
+  readStrings[nReadStrings++] = s;
+  return s;
+}
+
+/* reads a node with its subtrees and siblings */
+static TreeNode * readTree(InBuf * in)
+{ TreeNode * first = NULL, * last = NULL;
+  int flags;
+  do
+  { int kind = getByte(in), i;
+    TreeNode * t;
+    flags = getByte(in);
+    if (in->bad) return first;
+    if (kind & 0x40)
+    { if ((kind & 0x3f) > UnknownK) { in->bad = TRUE; return first; }
+      t = newExpNode((ExpKind)(kind & 0x3f));
+    }
+    else
+    { if (kind > TypeK) { in->bad = TRUE; return first; }
+      t = newStmtNode((StmtKind) kind);
+    }
+    t->is_array = (flags & F_ARRAY) != 0;
+    t->is_argu = (flags & F_ARGU) != 0;
+    t->var_type = NULL;
+    lastLineno += getInt(in);
+    t->lineno = lastLineno;
+
+    if (hasName(t))
+      t->attr.name = getString(in);
+    else if (hasArr(t))
+    { t->attr.arr.name = getString(in);
+      t->attr.arr.size = getInt(in);
+    }
+    else if (t->nodekind == ExpK && t->kind.exp == OpK)
+      t->attr.op = getInt(in);
+    else if (t->nodekind == ExpK && t->kind.exp == ConstK)
+      t->attr.val = getInt(in);
+
+    if (flags & F_VARTYPE)
+      t->var_type = (flags & F_INTEGER) ? &intTypeNode : &voidTypeNode;
+
+    if (first == NULL) first = t;
+    else last->sibling = t;
+    last = t;
+
+    for (i=0;i<MAXCHILDREN;i++)
+      if ((flags & (F_CHILD0 << i)) && !in->bad)
+        t->child[i] = readTree(in);
+  } while ((flags & F_SIBLING) && !in->bad);
+  return first;
+}
+
+/**************************************************/
+/*************   Cache file handling   ************/
+/**************************************************/
+
+/* reads the whole source file into memory */
+static char * readSource(long * len)
+{ char * buf = NULL;
+  long cap = 0, n = 0;
+  size_t got;
+  do
+  { if (n == cap)
+    { cap = cap ? cap * 2 : 65536;
+      buf = (char *) tagRealloc(CacheMem,buf,cap);
+    }
+    got = fread(buf + n,1,cap - n,source);
+    n += got;
+  } while (got > 0);
+  *len = n;
+  return buf;
+}
+
+static void cachePath(char * path, unsigned long long h)
+{ sprintf(path,"%s/%016llx.ast",AST_CACHE_DIR,h);
+}
+
+static void putHeader(OutBuf * o, long srclen, unsigned long long h)
+{ int i;
+  for (i=0;i<CACHE_MAGIC_LEN;i++) putByte(o,CACHE_MAGIC[i]);
+  putByte(o,CACHE_VERSION);
+  putUint(o,srclen);
+  for (i=0;i<8;i++) putByte(o,(int)((h >> (8*i)) & 0xff));
+}
+
+static TreeNode * cacheLoad(long srclen, unsigned long long h)
+{ char path[sizeof(AST_CACHE_DIR) + 32];
+  FILE * fp;
+  OutBuf hdr = { NULL, 0, 0 };
+  unsigned char * img;
+  long size;
+  InBuf in;
+  TreeNode * tree = NULL;
+
+  cachePath(path,h);
+  fp = fopen(path,"rb");
+  if (fp == NULL) return NULL;
+  fseek(fp,0,SEEK_END);
+  size = ftell(fp);
+  rewind(fp);
+  img = (unsigned char *) tagAlloc(CacheMem,size > 0 ? size : 1);
+  if (size <= 0 || fread(img,1,size,fp) != (size_t) size)
+  { fclose(fp);
+    free(img);
+    return NULL;
+  }
+  fclose(fp);
+
+  /* the header repeats the key, guarding
+   * against stale files and hash collisions
+   */
+  putHeader(&hdr,srclen,h);
+  if (size > hdr.len && memcmp(img,hdr.buf,hdr.len) == 0)
+  { in.p = img + hdr.len;
+    in.end = img + size;
+    in.bad = FALSE;
+    lastLineno = 0;
+    nReadStrings = 0;
+    tree = readTree(&in);
+    if (in.bad || in.p != in.end)
+      tree = NULL; /* corrupt file: parse the source instead */
+  }
+  free(hdr.buf);
+  free(img);
+  return tree;
+}
+
+static void cacheStore(long srclen, unsigned long long h, TreeNode * tree)
+{ char path[sizeof(AST_CACHE_DIR) + 32];
+  char tmp[sizeof(AST_CACHE_DIR) + 48];
+  OutBuf o = { NULL, 0, 0 };
+  FILE * fp;
+
+  putHeader(&o,srclen,h);
+  lastLineno = 0;
+  writeTree(&o,tree);
+  freeStrTable();
+
+  mkdir(AST_CACHE_DIR,0777);
+  cachePath(path,h);
+  /* write a private file first so that concurrent
+   * compilations never see a partial cache entry
+   */
+  sprintf(tmp,"%s.%ld",path,(long) getpid());
+  fp = fopen(tmp,"wb");
+  if (fp != NULL)
+  { int ok = fwrite(o.buf,1,o.len,fp) == (size_t) o.len;
+    if (fclose(fp) == 0 && ok)
+      rename(tmp,path);
+    else
+      remove(tmp);
+  }
+  free(o.buf);
+}
+
+/* Function cachedParse returns the syntax tree for
+ * the source file, deserializing it from the cache
+ * when a tree for identical source bytes was stored
+ * before, and otherwise calling parse() and storing
+ * the result (only if no syntax error occurred)
+ */
+TreeNode * cachedParse(void)
+{ long len, pos;
+  char * src = readSource(&len);
+  unsigned long long h = fnv1a(src,len);
+  TreeNode * tree;
+
+  tree = cacheLoad(len,h);
+  if (tree != NULL)
+  { free(src);
+    if (TraceParse)
+      fprintf(listing,"\nSyntax tree loaded from cache\n");
+    return tree;
+  }
+
+  /* a pipe cannot be read again: the text
+   * already read is parsed instead
+   */
+  if (fseek(source,0L,SEEK_SET) == 0)
+    tree = parse();
+  else
+  { pushScanBegin();
+    for (pos=0;pos<len;pos+=CHUNKSIZE)
+      if (!pushScanChunk(src+pos,len-pos < CHUNKSIZE ? (int) (len-pos) : CHUNKSIZE))
+        break;
+    tree = pushScanEnd();
+  }
+  free(src);
+  if (!Error && tree != NULL)
+    cacheStore(len,h,tree);
+  return tree;
+}
@@ -0,0 +1,23 @@
+/****************************************************/
+/* File: astcache.h                                 */
+/* Binary syntax tree cache interface for the       */
+/* C-minus compiler                                 */
+/****************************************************/
+
+#ifndef _ASTCACHE_H_
+#define _ASTCACHE_H_
+
+/* AST_CACHE_DIR is the directory holding one
+ * cache file per distinct source text
+ */
+#define AST_CACHE_DIR ".astcache"
+
+/* Function cachedParse returns the syntax tree for
+ * the source file, deserializing it from the cache
+ * when a tree for identical source bytes was stored
+ * before, and otherwise calling parse() and storing
+ * the result (only if no syntax error occurred)
+ */
+TreeNode * cachedParse(void);
+
+#endif
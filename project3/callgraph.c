@@ -0,0 +1,127 @@
+/****************************************************/
+/* File: callgraph.c                                */
+/* Call graph implementation for the C-minus        */
+/* compiler                                         */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "callgraph.h"
+#include "stats.h"
+
+/* the functions of the program, in source order */
+static TreeNode ** funcs = NULL;
+static int nFuncs = 0;
+
+/* the functions called by function i are callees[j]
+ * for callStart[i] <= j < callStart[i+1]
+ */
+static int * callStart = NULL;
+static int * callees = NULL;
+static int nCallees = 0, calleesSize = 0;
+
+/* funcOfGlobal[g] is the function declared as the
+ * global symbol of order g, or -1
+ */
+static int * funcOfGlobal = NULL;
+
+/* lastCaller[f] is the last function found to call
+ * function f, so each callee is kept once
+ */
+static int * lastCaller = NULL;
+static int caller;
+
+/* addCall adds the callee of call t to the callees
+ * of the function being scanned
+ */
+static void addCall(TreeNode * t)
+{ BucketList l = st_lookup_global(t->attr.name);
+  int f;
+  if (l == NULL || l->global_order < 0)
+    return;
+  f = funcOfGlobal[l->global_order];
+  if (f < 0 || lastCaller[f] == caller)
+    return;
+  lastCaller[f] = caller;
+  if (nCallees == calleesSize)
+  { calleesSize = calleesSize ? 2*calleesSize : 64;
+    callees = (int *) tagRealloc(AnalyzeMem,callees,calleesSize * sizeof(int));
+  }
+  callees[nCallees++] = f;
+}
+
+static const NodeProc callVisitor[NODETYPES] = { [CallT] = addCall };
+
+void buildCallGraph(TreeNode * syntaxTree)
+{ TreeNode * t;
+  int nGlobals = st_global_count(), i;
+  nFuncs = 0;
+  for (t=syntaxTree;t!=NULL;t=t->sibling)
+    if (t->kind.stmt == FuncK)
+      nFuncs++;
+  free(funcs);
+  free(callStart);
+  free(funcOfGlobal);
+  free(lastCaller);
+  funcs = (TreeNode **) tagAlloc(AnalyzeMem,(nFuncs+1) * sizeof(TreeNode *));
+  callStart = (int *) tagAlloc(AnalyzeMem,(nFuncs+1) * sizeof(int));
+  funcOfGlobal = (int *) tagAlloc(AnalyzeMem,(nGlobals+1) * sizeof(int));
+  lastCaller = (int *) tagAlloc(AnalyzeMem,(nFuncs+1) * sizeof(int));
+  for (i=0;i<nGlobals;i++)
+    funcOfGlobal[i] = -1;
+  for (t=syntaxTree,i=0;t!=NULL;t=t->sibling)
+    if (t->kind.stmt == FuncK)
+    { BucketList l = st_lookup_global(t->attr.name);
+      if (l != NULL && l->global_order >= 0)
+        funcOfGlobal[l->global_order] = i;
+      lastCaller[i] = -1;
+      funcs[i++] = t;
+    }
+  nCallees = 0;
+  for (caller=0;caller<nFuncs;caller++)
+  { TreeNode * body = funcs[caller]->child[1];
+    callStart[caller] = nCallees;
+    if (body != NULL)
+      traverseTree(body,callVisitor,NULL);
+  }
+  callStart[nFuncs] = nCallees;
+}
+
+TreeNode * dropUnreachable(TreeNode * syntaxTree, int * dropped)
+{ char * reached;
+  int * stack, top = 0, i, j;
+  TreeNode * t, * prev = NULL;
+  *dropped = 0;
+  for (i=nFuncs-1;i>=0;i--)
+    if (strcmp(funcs[i]->attr.name,"main") == 0)
+      break;
+  if (i < 0)
+    return syntaxTree;
+  reached = (char *) tagCalloc(AnalyzeMem,nFuncs,1);
+  stack = (int *) tagAlloc(AnalyzeMem,nFuncs * sizeof(int));
+  reached[i] = TRUE;
+  stack[top++] = i;
+  while (top > 0)
+  { i = stack[--top];
+    for (j=callStart[i];j<callStart[i+1];j++)
+      if (!reached[callees[j]])
+      { reached[callees[j]] = TRUE;
+        stack[top++] = callees[j];
+      }
+  }
+  for (t=syntaxTree,i=0;t!=NULL;t=t->sibling)
+  { if (t->kind.stmt == FuncK && !reached[i++])
+    { if (prev == NULL)
+        syntaxTree = t->sibling;
+      else
+        prev->sibling = t->sibling;
+      (*dropped)++;
+    }
+    else
+      prev = t;
+  }
+  free(reached);
+  free(stack);
+  return syntaxTree;
+}
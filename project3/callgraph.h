@@ -0,0 +1,25 @@
+/****************************************************/
+/* File: callgraph.h                                */
+/* Call graph interface for the C-minus compiler    */
+/****************************************************/
+
+#ifndef _CALLGRAPH_H_
+#define _CALLGRAPH_H_
+
+/* Procedure buildCallGraph builds the call graph of
+ * syntaxTree, which was analyzed without errors:
+ * its functions are numbered in source order, and
+ * each call is resolved through the symbol table
+ * to the function it calls
+ */
+void buildCallGraph(TreeNode * syntaxTree);
+
+/* Function dropUnreachable removes from syntaxTree
+ * the functions that main cannot reach through the
+ * call graph, and returns the tree; it puts the
+ * number removed in dropped. A program without
+ * main is left alone
+ */
+TreeNode * dropUnreachable(TreeNode * syntaxTree, int * dropped);
+
+#endif
@@ -0,0 +1,669 @@
+/****************************************************/
+/* File: cgen.c                                     */
+/* The code generator implementation for the        */
+/* C-minus compiler (generates code for the TM      */
+/* machine)                                         */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "code.h"
+#include "ir.h"
+#include "lvn.h"
+#include "licm.h"
+#include "cgen.h"
+#include "peep.h"
+#include "stats.h"
+
+/* fp = "frame pointer" points to the activation
+ * record of the running function; it takes the
+ * register of mp, which C-minus does not use
+ */
+#define fp mp
+
+/* The activation record of a function grows
+ * downward from fp: the fp of the caller (the
+ * control link) is at ofpFO(fp), the return
+ * address at retFO(fp), and the local of memory
+ * location k (see get_location) at initFO-k(fp),
+ * parameters first. Temps go below the locals.
+ * A caller builds the record of the callee below
+ * its own temps, storing the arguments where the
+ * callee finds its parameters; an array argument
+ * is passed as the address of its first element
+ */
+#define ofpFO 0
+#define retFO -1
+#define initFO -2
+
+/* the code location of each function, by the
+ * declaration order of its global symbol; a
+ * function is declared before it is called, so
+ * the location of a callee is always known
+ */
+static int * funcLoc = NULL;
+
+/* frameSize is the number of words of the locals
+ * of the function being generated
+ */
+static int frameSize;
+
+/* the three-address code of the function being
+ * generated
+ */
+static IrFunc * fn;
+
+/* how a temp is kept until it is read: InAc if
+ * its only reader follows it, with nothing in
+ * between that generates code; Remat if it is
+ * computed again by each reader, which is done for
+ * constants, array addresses and variables not
+ * assigned before the readers; else in a register
+ * or, when none is free, in a slot
+ */
+typedef enum {InSlot,InAc,Remat,InReg} TempPlace;
+
+/* temp t is kept as place[t] says: in register
+ * slot[t] if InReg, at slot[t](fp) below the locals
+ * if InSlot; it is set by def[t] and read nReads[t]
+ * times. nSlots is the number of slots, which temps
+ * that are never live at the same time share
+ */
+static TempPlace * place;
+static IrInstr ** def;
+static int * slot, * nReads;
+static int nSlots;
+
+/* blockLoc[b] is the code location of block b, or
+ * -1 until it is generated
+ */
+static int * blockLoc;
+
+/* Fixup is a jump to a block not generated yet,
+ * skipped at location loc
+ */
+typedef struct
+   { int loc;
+     char * op;
+     int r;
+     int block;
+     char * comment;
+   } Fixup;
+
+static Fixup * fixups = NULL;
+static int nFixups, fixupsSize = 0;
+
+/* sizeFrame makes frameSize cover the memory
+ * location of the local declared at node t
+ */
+static void sizeFrame(TreeNode * t)
+{ if (t->symbol != NULL && t->symbol->memloc >= frameSize)
+    frameSize = t->symbol->memloc + 1;
+}
+
+static const NodeProc sizeVisitor[NODETYPES] =
+   { [VarT] = sizeFrame, [ArrVarT] = sizeFrame,
+     [ParamT] = sizeFrame, [ArrParamT] = sizeFrame };
+
+/* varBase and varOffset give the base register
+ * and the offset of variable s
+ */
+static int varBase(BucketList s)
+{ return s->global_order >= 0 ? gp : fp;
+}
+
+static int varOffset(BucketList s)
+{ return s->global_order >= 0 ? s->memloc : initFO - s->memloc;
+}
+
+/* genArrayBase loads the address of the first
+ * element of array s into register r
+ */
+static void genArrayBase(BucketList s, int r)
+{ if (s->kind.stmt == ArrParamK)
+    emitRM("LD",r,varOffset(s),varBase(s),"load array address");
+  else
+    emitRM("LDA",r,varOffset(s),varBase(s),"compute array address");
+}
+
+/* genReturn generates code to return from the
+ * function, whose value is in ac
+ */
+static void genReturn(void)
+{ emitRM("LD",ac1,retFO,fp,"load return address");
+  emitRM("LD",fp,ofpFO,fp,"pop frame");
+  emitRM("LDA",pc,0,ac1,"return to caller");
+}
+
+/* killsLoad tells whether instruction i may
+ * change the variable loaded by load d
+ */
+static int killsLoad(IrInstr * i, IrInstr * d)
+{ return (i->op == IrStore && i->sym == d->sym) ||
+         (i->op == IrCall && d->sym->global_order >= 0);
+}
+
+/* placeTemps sets place, def and nReads for the
+ * temps of fn
+ */
+static void placeTemps(void)
+{ int n = fn->nTemps, b, k, j, t;
+  int * defBlock = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  int * defPos = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  int * lastRead = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  for (t=0;t<n;t++)
+  { place[t] = InSlot;
+    def[t] = NULL;
+    nReads[t] = 0;
+    defBlock[t] = -1;
+    lastRead[t] = 0;
+  }
+  for (b=0;b<fn->nBlocks;b++)
+  { IrBlock * p = &fn->blocks[b];
+    for (k=0;k<p->nCode;k++)
+    { int uses[2], m = irUses(&p->code[k],uses);
+      for (j=0;j<m;j++)
+      { t = uses[j];
+        nReads[t]++;
+        /* a read outside the block of the temp, or
+         * before it is set, is marked -1
+         */
+        if (defBlock[t] != b)
+          lastRead[t] = -1;
+        else if (lastRead[t] >= 0)
+          lastRead[t] = k;
+      }
+      t = p->code[k].dst;
+      if (t >= 0)
+      { def[t] = &p->code[k];
+        defBlock[t] = b;
+        defPos[t] = k;
+        if (lastRead[t] >= 0)
+          lastRead[t] = k;
+      }
+    }
+  }
+  for (t=0;t<n;t++)
+    if (def[t] == NULL)
+      continue; /* set in code that was removed */
+    else if (def[t]->op == IrConst || def[t]->op == IrAddr)
+      place[t] = Remat;
+    else if (def[t]->op == IrLoad && lastRead[t] >= 0)
+    { IrBlock * p = &fn->blocks[defBlock[t]];
+      for (k=defPos[t]+1;k<lastRead[t] && !killsLoad(&p->code[k],def[t]);k++)
+        ;
+      if (k >= lastRead[t])
+        place[t] = Remat;
+    }
+  for (t=0;t<n;t++)
+    if (place[t] == InSlot && nReads[t] == 1 && lastRead[t] > defPos[t])
+    { IrBlock * p = &fn->blocks[defBlock[t]];
+      for (k=defPos[t]+1;k<lastRead[t];k++)
+        if (p->code[k].dst < 0 || place[p->code[k].dst] != Remat)
+          break;
+      if (k == lastRead[t])
+        place[t] = InAc;
+    }
+  free(defBlock);
+  free(defPos);
+  free(lastRead);
+}
+
+/* the starts of the intervals of the temps, by
+ * which byStart orders them
+ */
+static int * intervalStart;
+
+static int byStart(const void * a, const void * b)
+{ int s = *(const int *) a, t = *(const int *) b;
+  if (intervalStart[s] != intervalStart[t])
+    return intervalStart[s] < intervalStart[t] ? -1 : 1;
+  return s - t;
+}
+
+/* allocTemps keeps the temps of fn not placed yet
+ * in the registers firstReg to lastReg, or in slots
+ * when more are live at once, by a linear scan over
+ * the intervals in which the temps are live. A call
+ * changes the registers, so a temp live across one
+ * goes to a slot
+ */
+static void allocTemps(void)
+{ int n = fn->nTemps, pos = 0, nPos = 0, nOrder, b, k, j, t;
+  int * start = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  int * end = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  int * order = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  int * slotEnd = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  int * calls, regTemp[lastReg+1];
+  for (b=0;b<fn->nBlocks;b++)
+    nPos += fn->blocks[b].nCode;
+  /* calls[p] is the number of calls before
+   * position p
+   */
+  calls = (int *) tagAlloc(CodeGenMem,(nPos+1) * sizeof(int));
+  for (t=0;t<n;t++)
+  { start[t] = -1;
+    end[t] = -1;
+  }
+  calls[0] = 0;
+  for (b=0;b<fn->nBlocks;b++)
+  { IrBlock * p = &fn->blocks[b];
+    int first = pos;
+    for (k=0;k<p->nCode;k++,pos++)
+    { int uses[2], m = irUses(&p->code[k],uses);
+      calls[pos+1] = calls[pos] + (p->code[k].op == IrCall);
+      for (j=0;j<m;j++)
+        end[uses[j]] = pos;
+      t = p->code[k].dst;
+      if (t >= 0)
+      { if (start[t] < 0) start[t] = pos;
+        if (end[t] < pos) end[t] = pos;
+      }
+    }
+    for (j=0;j<fn->nCross;j++)
+    { t = fn->cross[j];
+      if (irHas(p->liveIn,j) && (start[t] < 0 || start[t] > first))
+        start[t] = first;
+      if (irHas(p->liveOut,j))
+        end[t] = pos - 1;
+    }
+  }
+  /* the temps to place by the start of their
+   * intervals
+   */
+  for (t=0,nOrder=0;t<n;t++)
+    if (place[t] == InSlot && nReads[t] > 0)
+      order[nOrder++] = t;
+  intervalStart = start;
+  qsort(order,nOrder,sizeof(int),byStart);
+  for (j=firstReg;j<=lastReg;j++)
+    regTemp[j] = -1;
+  for (k=0;k<nOrder;k++)
+  { int spill = -1;
+    t = order[k];
+    if (calls[end[t]] - calls[start[t]+1] > 0)
+      continue;
+    for (j=firstReg;j<=lastReg;j++)
+    { int u = regTemp[j];
+      if (u < 0 || end[u] <= start[t])
+        break;
+      if (spill < 0 || end[u] > end[regTemp[spill]])
+        spill = j;
+    }
+    if (j > lastReg)
+    { /* the temp live longest goes to a slot */
+      if (end[regTemp[spill]] <= end[t])
+        continue;
+      place[regTemp[spill]] = InSlot;
+      j = spill;
+    }
+    place[t] = InReg;
+    slot[t] = j;
+    regTemp[j] = t;
+  }
+  nSlots = 0;
+  for (k=0;k<nOrder;k++)
+  { t = order[k];
+    if (place[t] != InSlot)
+      continue;
+    for (j=0;j<nSlots && slotEnd[j]>start[t];j++)
+      ;
+    if (j == nSlots)
+      nSlots++;
+    slotEnd[j] = end[t];
+    slot[t] = initFO - frameSize - j;
+  }
+  free(start);
+  free(end);
+  free(order);
+  free(slotEnd);
+  free(calls);
+}
+
+/* genValue computes the value of instruction d,
+ * which sets a temp kept Remat, into register r
+ */
+static void genValue(IrInstr * d, int r)
+{ switch (d->op)
+  { case IrConst:
+      emitRM("LDC",r,d->val,0,"load const");
+      break;
+    case IrAddr:
+      genArrayBase(d->sym,r);
+      break;
+    default:
+      emitRM("LD",r,varOffset(d->sym),varBase(d->sym),"load id value");
+      break;
+  }
+}
+
+/* loadTemp loads temp t into register r */
+static void loadTemp(int r, int t)
+{ switch (place[t])
+  { case InAc:
+      if (r != ac)
+        emitRM("LDA",r,0,ac,"move temp");
+      break;
+    case InReg:
+      if (r != slot[t])
+        emitRM("LDA",r,0,slot[t],"move temp");
+      break;
+    case Remat:
+      genValue(def[t],r);
+      break;
+    default:
+      if (nReads[t] == 1)
+        emitRM_Tmp("LD",r,slot[t],fp,"load temp");
+      else
+        emitRM("LD",r,slot[t],fp,"load temp");
+      break;
+  }
+}
+
+/* operand returns a register holding temp t,
+ * loading it into register r if needed
+ */
+static int operand(int t, int r)
+{ if (place[t] == InReg)
+    return slot[t];
+  if (place[t] != InAc || r != ac)
+    loadTemp(r,t);
+  return r;
+}
+
+/* operands puts in *ra and *rb registers holding
+ * the temps a and b read by instruction i, using
+ * ac1 and ac if needed
+ */
+static void operands(IrInstr * i, int * ra, int * rb)
+{ if (place[i->a] == InAc && place[i->b] == InReg)
+  { *ra = ac;
+    *rb = slot[i->b];
+  }
+  else
+  { *ra = operand(i->a,ac1);
+    *rb = operand(i->b,ac);
+  }
+}
+
+/* storeTemp stores ac into temp t, if it is kept
+ * in a slot and read
+ */
+static void storeTemp(int t)
+{ if (t < 0 || place[t] != InSlot || nReads[t] == 0)
+    return;
+  if (nReads[t] == 1)
+    emitRM_Tmp("ST",ac,slot[t],fp,"store temp");
+  else
+    emitRM("ST",ac,slot[t],fp,"store temp");
+}
+
+/* isConst tells whether temp t is a constant that
+ * fits the offset of an LDA, and puts it in k
+ */
+static int isConst(int t, int * k)
+{ if (place[t] != Remat || def[t]->op != IrConst || def[t]->val == INT_MIN)
+    return FALSE;
+  *k = def[t]->val;
+  return TRUE;
+}
+
+/* jumpOp returns the TM jump taken when a value
+ * compares to 0 as operator op says
+ */
+static char * jumpOp(int op)
+{ switch (op)
+  { case LT : return "JLT";
+    case LE : return "JLE";
+    case GT : return "JGT";
+    case GE : return "JGE";
+    case EQ : return "JEQ";
+    default : return "JNE";
+  }
+}
+
+/* genJump generates jump op on register r to
+ * block b, patched later if b comes after
+ */
+static void genJump(char * op, int r, int b, char * c)
+{ if (blockLoc[b] >= 0)
+  { emitRM_Abs(op,r,blockLoc[b],c);
+    return;
+  }
+  if (nFixups == fixupsSize)
+  { fixupsSize = fixupsSize ? 2*fixupsSize : 64;
+    fixups = (Fixup *) tagRealloc(CodeGenMem,fixups,fixupsSize * sizeof(Fixup));
+  }
+  fixups[nFixups].loc = emitSkip(1);
+  fixups[nFixups].op = op;
+  fixups[nFixups].r = r;
+  fixups[nFixups].block = b;
+  fixups[nFixups].comment = c;
+  nFixups++;
+}
+
+/* genCall generates code for call i of a function
+ * of the program, whose arguments were stored
+ */
+static void genCall(IrInstr * i, int frame)
+{ int entry = funcLoc[i->sym->global_order];
+  emitRM("ST",fp,frame+ofpFO,fp,"call: store old fp");
+  emitRM("LDA",fp,frame,fp,"call: push frame");
+  emitRM("LDA",ac,1,pc,"call: save return address in ac");
+  if (entry < 0)
+    emitComment("BUG: call of a function without code");
+  emitRM_Abs("LDA",pc,entry,"call: jump to function");
+}
+
+/* genInstr generates code for instruction i of
+ * block b
+ */
+static void genInstr(IrInstr * i, int b)
+{ /* a call builds the record of the callee below
+   * the temps
+   */
+  int frame = initFO - frameSize - nSlots, k, ra, rb;
+  /* the register the value is computed into */
+  int rd = i->dst >= 0 && place[i->dst] == InReg ? slot[i->dst] : ac;
+  if (i->dst >= 0 && place[i->dst] == Remat)
+    return;
+  switch (i->op)
+  { case IrConst:
+    case IrLoad:
+    case IrAddr:
+      genValue(i,rd);
+      break;
+    case IrStore:
+      emitRM("ST",operand(i->a,ac),varOffset(i->sym),varBase(i->sym),
+             "assign: store value");
+      break;
+    case IrLoadI:
+      emitRM("LD",rd,0,operand(i->a,ac),"load element value");
+      break;
+    case IrStoreI:
+      operands(i,&ra,&rb);
+      emitRM("ST",rb,0,ra,"assign: store value");
+      break;
+    case IrBin:
+      /* a constant added is the offset of an LDA */
+      if ((i->val == PLUS || i->val == MINUS) && isConst(i->b,&k))
+      { emitRM("LDA",rd,i->val == PLUS ? k : -k,operand(i->a,ac),"op + const");
+        break;
+      }
+      if (i->val == PLUS && isConst(i->a,&k))
+      { emitRM("LDA",rd,k,operand(i->b,ac),"op + const");
+        break;
+      }
+      operands(i,&ra,&rb);
+      switch (i->val)
+      { case PLUS : emitRO("ADD",rd,ra,rb,"op +"); break;
+        case MINUS : emitRO("SUB",rd,ra,rb,"op -"); break;
+        case TIMES : emitRO("MUL",rd,ra,rb,"op *"); break;
+        case OVER : emitRO("DIV",rd,ra,rb,"op /"); break;
+        default :
+          emitRO("SUB",rd,ra,rb,"op compare");
+          emitRM(jumpOp(i->val),rd,2,pc,"br if true");
+          emitRM("LDC",rd,0,rd,"false case");
+          emitRM("LDA",pc,1,pc,"unconditional jmp");
+          emitRM("LDC",rd,1,rd,"true case");
+          break;
+      }
+      break;
+    case IrCopy:
+      ra = operand(i->a,rd);
+      if (ra != rd)
+        emitRM("LDA",rd,0,ra,"copy temp");
+      break;
+    case IrArg:
+      emitRM("ST",operand(i->a,ac),frame+initFO-i->val,fp,
+             "call: store argument");
+      break;
+    case IrCall:
+      genCall(i,frame);
+      if (rd != ac)
+        emitRM("LDA",rd,0,ac,"keep value returned");
+      break;
+    case IrIn:
+      emitRO("IN",rd,0,0,"read integer value");
+      break;
+    case IrOut:
+      emitRO("OUT",operand(i->a,ac),0,0,"write value");
+      break;
+    case IrJump:
+      if (i->target[0] != b+1)
+        genJump("LDA",pc,i->target[0],"jmp");
+      break;
+    case IrBranch:
+      ra = operand(i->a,ac);
+      /* the block after b needs no jump */
+      if (i->target[0] == b+1)
+        genJump(jumpOp(irNegate(i->val)),ra,i->target[1],"br if false");
+      else
+      { genJump(jumpOp(i->val),ra,i->target[0],"br if true");
+        if (i->target[1] != b+1)
+          genJump("LDA",pc,i->target[1],"jmp");
+      }
+      break;
+    case IrRet:
+      if (i->a >= 0)
+        loadTemp(ac,i->a);
+      genReturn();
+      break;
+  }
+  storeTemp(i->dst);
+}
+
+/* genFunc generates code for the function declared
+ * at node tree
+ */
+static void genFunc(TreeNode * tree)
+{ char label[32];
+  int b, k;
+  if (TraceCode) emitComment("-> function") ;
+  if (TraceCode) emitComment(tree->attr.name) ;
+  fn = irBuild(tree);
+  if (Optimize)
+  { valueNumber(fn);
+    /* the code moved into one preheader may
+     * compute a value twice
+     */
+    if (hoistInvariants(fn) > 0)
+      valueNumber(fn);
+  }
+  if (TraceIR)
+    irDump(listing,fn);
+  irLiveness(fn);
+  frameSize = 0;
+  traverseTree(tree->child[0],sizeVisitor,NULL);
+  traverseTree(tree->child[1],sizeVisitor,NULL);
+  place = (TempPlace *) tagAlloc(CodeGenMem,(fn->nTemps+1) * sizeof(TempPlace));
+  def = (IrInstr **) tagAlloc(CodeGenMem,(fn->nTemps+1) * sizeof(IrInstr *));
+  slot = (int *) tagAlloc(CodeGenMem,(fn->nTemps+1) * sizeof(int));
+  nReads = (int *) tagAlloc(CodeGenMem,(fn->nTemps+1) * sizeof(int));
+  blockLoc = (int *) tagAlloc(CodeGenMem,(fn->nBlocks+1) * sizeof(int));
+  placeTemps();
+  allocTemps();
+  funcLoc[tree->symbol->global_order] = emitSkip(0);
+  emitRM("ST",ac,retFO,fp,"function: store return address");
+  for (b=0;b<fn->nBlocks;b++)
+    blockLoc[b] = -1;
+  nFixups = 0;
+  for (b=0;b<fn->nBlocks;b++)
+  { blockLoc[b] = emitSkip(0);
+    if (TraceCode)
+    { sprintf(label,"B%d",b);
+      emitComment(label);
+    }
+    for (k=0;k<fn->blocks[b].nCode;k++)
+      genInstr(&fn->blocks[b].code[k],b);
+  }
+  for (k=0;k<nFixups;k++)
+  { emitBackup(fixups[k].loc);
+    emitRM_Abs(fixups[k].op,fixups[k].r,blockLoc[fixups[k].block],
+                fixups[k].comment);
+  }
+  emitRestore();
+  free(place);
+  free(def);
+  free(slot);
+  free(nReads);
+  free(blockLoc);
+  irFree(fn);
+  fn = NULL;
+  if (TraceCode)  emitComment("<- function") ;
+}
+
+/**********************************************/
+/* the primary function of the code generator */
+/**********************************************/
+/* Procedure codeGen generates code to a code
+ * file by traversal of the syntax tree. The
+ * second parameter (codefile) is the file name
+ * of the code file, and is used to print the
+ * file name as a comment in the code file
+ */
+void codeGen(TreeNode * syntaxTree, char * codefile)
+{  char * s = tagAlloc(CodeGenMem,strlen(codefile)+7);
+   TreeNode * t;
+   int nGlobals = st_global_count(), i, savedLoc;
+   BucketList mainFunc = st_lookup_global("main");
+   strcpy(s,"File: ");
+   strcat(s,codefile);
+   funcLoc = (int *) tagAlloc(CodeGenMem,(nGlobals+1) * sizeof(int));
+   for (i=0;i<=nGlobals;i++)
+     funcLoc[i] = -1;
+   emitComment("C-MINUS Compilation to TM Code");
+   emitComment(s);
+   /* generate standard prelude */
+   emitComment("Standard prelude:");
+   emitRM("LD",fp,0,ac,"load maxaddress from location 0");
+   emitRM("ST",ac,0,ac,"clear location 0");
+   emitComment("End of standard prelude.");
+   /* call main, with its record at the top of memory */
+   emitRM("LDA",ac,1,pc,"save return address in ac");
+   savedLoc = emitSkip(1);
+   emitComment("jump to main belongs here");
+   /* finish */
+   emitComment("End of execution.");
+   emitRO("HALT",0,0,0,"");
+   /* generate code for the functions of the program */
+   for (t=syntaxTree;t!=NULL;t=t->sibling)
+     if (t->nodekind == StmtK && t->kind.stmt == FuncK)
+       genFunc(t);
+   emitBackup(savedLoc);
+   if (mainFunc != NULL && funcLoc[mainFunc->global_order] >= 0)
+     emitRM_Abs("LDA",pc,funcLoc[mainFunc->global_order],"jump to main");
+   else
+     emitRO("HALT",0,0,0,"no main");
+   emitRestore();
+   if (Optimize) peephole();
+   emitFlush();
+   free(funcLoc);
+   funcLoc = NULL;
+   free(fixups);
+   fixups = NULL;
+   fixupsSize = 0;
+   free(s);
+}
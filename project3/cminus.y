@@ -11,8 +11,15 @@
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "pushscan.h"
+#include "stats.h"
 
 #define YYSTYPE TreeNode *
+
+/* the parser stack lives on the heap; allow deeply
+ * nested generated programs
+ */
+#define YYMAXDEPTH 1000000
 static char * savedName; /* for use in assignments */
 static int savedLineNo;  /* ditto */
 static int savedNum; /* trans char * to int */
@@ -20,31 +27,87 @@ static TreeNode * savedTree; /* stores syntax tree for later return */
 static int yylex(void); // added 11/2/11 to ensure no conflict with lex
 int yyerror(char * message);
 
+/* LISTCACHE is the number of list tails remembered
+ * by appendList
+ */
+#define LISTCACHE 64
+
+/* the tails of recently extended lists, by head; a
+ * parse starts with none, since the nodes of an
+ * earlier tree may have been freed and reused
+ */
+static struct { TreeNode * head, * tail; } cache[LISTCACHE];
+
+static void clearLists(void)
+{ memset(cache,0,sizeof(cache));
+}
+
+/* appendList links t after the last sibling of list
+ * and returns the list. The tail of recently extended
+ * lists is remembered, so building a list of n
+ * declarations, statements or arguments is O(n)
+ * instead of walking the whole list on every append
+ */
+static TreeNode * appendList(TreeNode * list, TreeNode * t)
+{ int h;
+  TreeNode * tail;
+  if (list == NULL) return t;
+  if (t == NULL) return list;
+  h = (int)(((unsigned long) list / sizeof(TreeNode)) % LISTCACHE);
+  tail = cache[h].head == list ? cache[h].tail : list;
+  while (tail->sibling != NULL)
+    tail = tail->sibling;
+  tail->sibling = t;
+  while (tail->sibling != NULL)
+    tail = tail->sibling;
+  cache[h].head = list;
+  cache[h].tail = tail;
+  return list;
+}
+
+/* brace depth inside the function body being
+ * skipped by a lazy parse, and the body's span
+ */
+static int skipDepth = 0;
+static LazyBody * skippedBody = NULL;
+
+/* TRUE while a skipped function body is parsed */
+static int parsingBody = FALSE;
+
+static int skipBodies(int token);
+
+/* source spans of the top-level declarations
+ * parsed so far, see noteDecl
+ */
+static SourceSpan * declSpanList = NULL;
+static int nDeclSpans = 0, declSpansSize = 0;
+static int declDepth = 0; /* brace depth in the declaration */
+static int declTokens = 0; /* tokens of the declaration */
+static int inDecl = FALSE;
+
+static void noteDecl(int token);
+static void resetDecls(void);
+
 %}
 
 %token IF ELSE WHILE RETURN INT VOID/* discarded */ THEN END REPEAT UNTIL READ WRITE
 %token ID NUM 
 %token ASSIGN EQ NE LT LE GT GE PLUS MINUS TIMES OVER LPAREN RPAREN LBRACE RBRACE LCURLY RCURLY SEMI COMMA
 %token ERROR 
+%token LAZYBODY FUNCBODY /* function bodies in lazy parses, see skipBodies */
+
+/* besides yyparse, generate yypush_parse so that
+ * tokens can be fed as the source text arrives
+ */
+%define api.push-pull both
 
 %% /* Grammar for Cminus */
 program		: dec_list {
 				savedTree = $1; 
 			}
+			| FUNCBODY comp_stmt { savedTree = $2; }
 			;
-dec_list	: dec_list dec { 
-				YYSTYPE t = $1;
-					
-				if (t != NULL) {
-					while (t->sibling != NULL)
-						t = t->sibling;
-
-					t->sibling = $2;
-					$$ = $1;
-				}
-				else
-					$$ = $2;
-			}
+dec_list	: dec_list dec { $$ = appendList($1, $2); }
 			| dec { $$ = $1; }
 			;
 dec			: var_dec { $$ = $1; }
@@ -67,41 +130,31 @@ save_name	: ID { savedName = copyString(tokenString); }
 
 save_num	: NUM { savedNum = atoi(tokenString); }
 
-type_spec	: INT { 
-				$$ = newStmtNode(TypeK); 
-				$$->type = Integer;
-			}
-			| VOID { 
-				$$ = newStmtNode(TypeK);
-				$$->type = Void; 
-			}
+type_spec	: INT { $$ = &intTypeNode; }
+			| VOID { $$ = &voidTypeNode; }
 			;
 func_dec	: type_spec save_name {
 				$$ = newStmtNode(FuncK);
 				$$->attr.name = savedName;
 			  }
-			  LPAREN params RPAREN comp_stmt {
+			  LPAREN params RPAREN func_body {
 				$$ = $3;
 				$$->var_type = $1;
 				$$->child[0] = $5;
 				$$->child[1] = $7;
+				if ($7 == NULL) {
+					$$->lazy_body = skippedBody;
+					skippedBody = NULL;
+				}
 			}
 			;
+func_body	: comp_stmt { $$ = $1; }
+			| LAZYBODY { $$ = NULL; }
+			;
 params		: param_list { $$ = $1; }
 			| VOID { $$ = newExpNode(NullParamK); }
 			;
-param_list	: param_list COMMA param {
-				YYSTYPE t = $1;
-				if (t != NULL) {
-					while (t->sibling != NULL)
-						t = t->sibling;
-
-					t->sibling = $3;
-					$$ = $1;
-				}
-				else
-					$$ = $3;
-			}
+param_list	: param_list COMMA param { $$ = appendList($1, $3); }
 			| param { $$ = $1; }
 			;
 param		: type_spec save_name {
@@ -125,32 +178,10 @@ comp_stmt	: LCURLY local_decs stmt_list RCURLY {
 				$$->child[1] = $3;
 			}
 			;
-local_decs	: local_decs var_dec {
-				YYSTYPE t = $1;
-				if (t != NULL) {
-					while (t->sibling != NULL)
-						t = t->sibling;
-
-					t->sibling = $2;
-					$$ = $1;
-				}
-				else
-					$$ = $2;
-			}
+local_decs	: local_decs var_dec { $$ = appendList($1, $2); }
 			| /* empty */ { $$ = NULL; }
 			;
-stmt_list	: stmt_list stmt {
-				YYSTYPE t = $1;
-				if (t != NULL) {
-					while (t->sibling != NULL)
-						t = t->sibling;
-
-					t->sibling = $2;
-					$$ = $1;
-				}
-				else
-					$$ = $2;
-			}
+stmt_list	: stmt_list stmt { $$ = appendList($1, $2); }
 			| /* empty */ { $$ = NULL; }
 			;
 stmt		: exp_stmt { $$ = $1; }
@@ -293,17 +324,8 @@ args		: arg_list { $$ = $1; }
 			| /* empty */ { $$ = NULL; }
 			;
 arg_list	: arg_list COMMA exp {
-				YYSTYPE t = $1;
-				if (t != NULL) {
-					while (t->sibling != NULL)
-						t = t->sibling;
-
-					$3->is_argu = TRUE;
-					t->sibling = $3;
-					$$ = $1;
-				}
-				else
-					$$ = $3;
+				$3->is_argu = TRUE;
+				$$ = appendList($1, $3);
 			}
 			| exp { 
 				$$ = $1; 
@@ -320,14 +342,188 @@ int yyerror(char * message)
   return 0;
 }
 
+/* skipBodies filters the tokens of a lazy parse.
+ * A left brace at global level can only start a
+ * function body: its tokens are brace-matched and
+ * replaced by a single LAZYBODY token, whose source
+ * span is left in skippedBody. The function returns
+ * the token to hand to the parser, or -1 if the
+ * token is swallowed
+ */
+static int skipBodies(int token)
+{ if (skipDepth == 0)
+  { if (token != LCURLY || !LazyBodies || parsingBody)
+      return token;
+    skippedBody = (LazyBody *) tagAlloc(ParseMem,sizeof(LazyBody));
+    skippedBody->start = tokenPos;
+    skippedBody->lineno = lineno;
+    skipDepth = 1;
+    return -1;
+  }
+  if (token == LCURLY)
+    skipDepth++;
+  else if (token == RCURLY && --skipDepth == 0)
+  { skippedBody->end = tokenPos + 1;
+    return LAZYBODY;
+  }
+  else if (token == 0) /* ENDFILE */
+  { skipDepth = 0;
+    return 0;
+  }
+  return -1;
+}
+
+/* noteDecl follows the tokens handed to the parser
+ * to find the source span of each top-level
+ * declaration: it starts at its first token and
+ * ends with a semicolon outside braces or with
+ * the brace closing a function body. Its tokens
+ * are hashed on the way
+ */
+static void noteDecl(int token)
+{ int end = FALSE;
+  if (parsingBody || token == 0) /* ENDFILE */
+    return;
+  if (!inDecl)
+  { if (nDeclSpans == declSpansSize)
+    { declSpansSize = declSpansSize ? 2*declSpansSize : 64;
+      declSpanList = (SourceSpan *) tagRealloc(ParseMem,declSpanList,
+                       declSpansSize * sizeof(SourceSpan));
+    }
+    declSpanList[nDeclSpans].start = tokenPos;
+    declSpanList[nDeclSpans].lineno = lineno;
+    declSpanList[nDeclSpans].hash = HASHBASIS;
+    inDecl = TRUE;
+    declDepth = 0;
+    declTokens = 0;
+  }
+  /* the second token is the declared name */
+  if (++declTokens != 2)
+  { SourceSpan * s = &declSpanList[nDeclSpans];
+    s->hash = hashInt(hashInt(s->hash,token),lineno - s->lineno);
+    if (token == ID || token == NUM)
+      s->hash = hashString(s->hash,tokenString);
+  }
+  if (token == LCURLY)
+    declDepth++;
+  else if (token == RCURLY)
+    end = --declDepth == 0;
+  else if (token == LAZYBODY)
+  { declSpanList[nDeclSpans].end = skippedBody->end;
+    declSpanList[nDeclSpans].hash = 0;
+    inDecl = FALSE;
+    nDeclSpans++;
+    return;
+  }
+  else if (token == SEMI)
+    end = declDepth == 0;
+  if (end)
+  { declSpanList[nDeclSpans].end = tokenPos + 1;
+    inDecl = FALSE;
+    nDeclSpans++;
+  }
+}
+
+static void resetDecls(void)
+{ if (parsingBody)
+    return;
+  nDeclSpans = 0;
+  inDecl = FALSE;
+}
+
+/* Function declSpans returns the source spans of
+ * the top-level declarations of the last parse, in
+ * order, and puts their number in n
+ */
+SourceSpan * declSpans(int * n)
+{ *n = nDeclSpans;
+  return declSpanList;
+}
+
 /* yylex calls getToken to make Yacc/Bison output
  * compatible with ealier versions of the TINY scanner
  */
 static int yylex(void)
-{ return getToken(); }
+{ int token;
+  do
+    token = skipBodies(getToken());
+  while (token < 0);
+  noteDecl(token);
+  return token;
+}
 
 TreeNode * parse(void)
-{ yyparse();
+{ resetDecls();
+  clearLists();
+  yyparse();
   return savedTree;
 }
 
+/* the parser state of a push parse in progress */
+static yypstate * pushState = NULL;
+
+/* Procedure pushParseBegin starts a push parse */
+void pushParseBegin(void)
+{ savedTree = NULL;
+  resetDecls();
+  clearLists();
+  pushState = yypstate_new();
+}
+
+/* Function pushToken feeds one token, whose lexeme
+ * is in tokenString, to the push parser. It returns
+ * TRUE while the parser expects more tokens
+ */
+int pushToken(TokenType token)
+{ int status;
+  if (pushState == NULL)
+    return FALSE;
+  token = skipBodies(token);
+  if (token < 0)
+    return TRUE;
+  noteDecl(token);
+  yychar = token;
+  status = yypush_parse(pushState);
+  if (status != YYPUSH_MORE)
+  { yypstate_delete(pushState);
+    pushState = NULL;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Function pushParseEnd returns the syntax tree
+ * built by the push parse
+ */
+TreeNode * pushParseEnd(void)
+{ if (pushState != NULL)
+  { yypstate_delete(pushState);
+    pushState = NULL;
+  }
+  return savedTree;
+}
+
+
+/* Procedure parseLazyBody parses the body of function
+ * t, skipped by a lazy parse, from its source span
+ */
+void parseLazyBody(TreeNode * t)
+{ LazyBody * b = t->lazy_body;
+  long len = b->end - b->start;
+  char * buf = (char *) tagAlloc(ParseMem,len);
+  int savedLineno = lineno;
+  t->lazy_body = NULL;
+  if (fseek(source,b->start,SEEK_SET) == 0 &&
+      fread(buf,1,len,source) == (size_t) len)
+  { parsingBody = TRUE;
+    t->child[1] = pushScanBody(buf,len,b->start,b->lineno);
+    parsingBody = FALSE;
+  }
+  else
+  { fprintf(listing,"Unable to reread the body of function %s\n",t->attr.name);
+    Error = TRUE;
+  }
+  lineno = savedLineno;
+  free(buf);
+  free(b);
+}
@@ -0,0 +1,234 @@
+/****************************************************/
+/* File: code.c                                     */
+/* TM Code emitting utilities                       */
+/* implementation for the TINY compiler             */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+#include "stats.h"
+
+/* TM location number for current instruction emission */
+static int emitLoc = 0 ;
+
+/* Highest TM location emitted so far
+   For use in conjunction with emitSkip,
+   emitBackup, and emitRestore */
+static int highEmitLoc = 0;
+
+/* the instructions by location: they are kept in
+ * memory, so that a backpatch overwrites a skipped
+ * location, and written by emitFlush in order
+ */
+static Instr * instrs = NULL;
+static int instrsSize = 0;
+
+/* Comment is a comment line, printed before the
+ * instruction at location loc
+ */
+typedef struct
+   { int loc;
+     char * text;
+   } Comment;
+
+static Comment * comments = NULL;
+static int nComments = 0, commentsSize = 0;
+
+/* emitInstr stores an instruction at emitLoc and
+ * advances emitLoc
+ */
+static void emitInstr( char * op, int isRO, int r, int s, int t, char * c)
+{ Instr * i;
+  if (emitLoc >= instrsSize)
+  { int n = instrsSize ? 2*instrsSize : 256, k;
+    while (n <= emitLoc) n *= 2;
+    instrs = (Instr *) tagRealloc(CodeGenMem,instrs,n * sizeof(Instr));
+    for (k=instrsSize;k<n;k++) instrs[k].op = NULL;
+    instrsSize = n;
+  }
+  i = &instrs[emitLoc++];
+  i->op = op;
+  i->isRO = isRO;
+  i->r = r;
+  i->s = s;
+  i->t = t;
+  i->isTemp = FALSE;
+  i->comment = c;
+  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+}
+
+/* Procedure emitComment prints a comment line 
+ * with comment c in the code file
+ */
+void emitComment( char * c )
+{ int k;
+  if (TraceCode)
+  { if (nComments == commentsSize)
+    { commentsSize = commentsSize ? 2*commentsSize : 64;
+      comments = (Comment *) tagRealloc(CodeGenMem,comments,commentsSize * sizeof(Comment));
+    }
+    /* comments are kept in location order */
+    for (k=nComments;k>0 && comments[k-1].loc>emitLoc;k--)
+      comments[k] = comments[k-1];
+    comments[k].loc = emitLoc;
+    comments[k].text = (char *) tagAlloc(CodeGenMem,strlen(c)+1);
+    strcpy(comments[k].text,c);
+    nComments++;
+  }
+}
+
+/* Procedure emitRO emits a register-only
+ * TM instruction
+ * op = the opcode
+ * r = target register
+ * s = 1st source register
+ * t = 2nd source register
+ * c = a comment to be printed if TraceCode is TRUE
+ */
+void emitRO( char *op, int r, int s, int t, char *c)
+{ emitInstr(op,TRUE,r,s,t,c);
+} /* emitRO */
+
+/* Procedure emitRM emits a register-to-memory
+ * TM instruction
+ * op = the opcode
+ * r = target register
+ * d = the offset
+ * s = the base register
+ * c = a comment to be printed if TraceCode is TRUE
+ */
+void emitRM( char * op, int r, int d, int s, char *c)
+{ emitInstr(op,FALSE,r,s,d,c);
+} /* emitRM */
+
+/* Function emitSkip skips "howMany" code
+ * locations for later backpatch. It also
+ * returns the current code position
+ */
+int emitSkip( int howMany)
+{  int i = emitLoc;
+   emitLoc += howMany ;
+   if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
+   return i;
+} /* emitSkip */
+
+/* Procedure emitBackup backs up to 
+ * loc = a previously skipped location
+ */
+void emitBackup( int loc)
+{ if (loc > highEmitLoc) emitComment("BUG in emitBackup");
+  emitLoc = loc ;
+} /* emitBackup */
+
+/* Procedure emitRestore restores the current 
+ * code position to the highest previously
+ * unemitted position
+ */
+void emitRestore(void)
+{ emitLoc = highEmitLoc;}
+
+/* Procedure emitRM_Tmp emits a register-to-memory
+ * TM instruction that pushes or pops a temp, like
+ * emitRM; the peephole optimizer may keep the temp
+ * in a register instead
+ */
+void emitRM_Tmp( char * op, int r, int d, int s, char *c)
+{ emitInstr(op,FALSE,r,s,d,c);
+  instrs[emitLoc-1].isTemp = TRUE;
+} /* emitRM_Tmp */
+
+/* Procedure emitRM_Abs converts an absolute reference 
+ * to a pc-relative reference when emitting a
+ * register-to-memory TM instruction
+ * op = the opcode
+ * r = target register
+ * a = the absolute location in memory
+ * c = a comment to be printed if TraceCode is TRUE
+ */
+void emitRM_Abs( char *op, int r, int a, char * c)
+{ emitInstr(op,FALSE,r,pc,a-(emitLoc+1),c);
+} /* emitRM_Abs */
+
+/* Function codeBuffer returns the instructions
+ * emitted so far, by location, and their number
+ * in *n
+ */
+Instr * codeBuffer( int * n)
+{ *n = highEmitLoc;
+  return instrs;
+} /* codeBuffer */
+
+/* Procedure emitCompact removes the locations
+ * without an opcode: the instructions after them
+ * move up, pc-relative offsets are adjusted to the
+ * new locations, and a reference to a removed
+ * location goes to the instruction after it
+ */
+void emitCompact(void)
+{ int * newLoc = (int *) tagAlloc(CodeGenMem,(highEmitLoc+1) * sizeof(int));
+  int loc, n = 0, k;
+  for (loc=0;loc<=highEmitLoc;loc++)
+  { newLoc[loc] = n;
+    if (loc < highEmitLoc && instrs[loc].op != NULL)
+      n++;
+  }
+  for (loc=0;loc<highEmitLoc;loc++)
+  { Instr * i = &instrs[loc];
+    if (i->op == NULL)
+      continue;
+    if (!i->isRO && i->s == pc)
+    { int a = loc + 1 + i->t;
+      if (a >= 0 && a <= highEmitLoc)
+        i->t = newLoc[a] - (newLoc[loc] + 1);
+    }
+    instrs[newLoc[loc]] = *i;
+  }
+  for (loc=n;loc<highEmitLoc;loc++)
+    instrs[loc].op = NULL;
+  for (k=0;k<nComments;k++)
+    comments[k].loc = newLoc[comments[k].loc];
+  emitLoc = highEmitLoc = n;
+  free(newLoc);
+} /* emitCompact */
+
+/* Procedure emitFlush writes the instructions
+ * emitted, in location order and with the comments
+ * before them, to the code file in a single write,
+ * and empties the buffer
+ */
+void emitFlush(void)
+{ char * buf;
+  long len = 0, size = 64;
+  int loc, k = 0;
+  for (loc=0;loc<highEmitLoc;loc++)
+    if (instrs[loc].op != NULL)
+      size += 64 + (TraceCode ? strlen(instrs[loc].comment) : 0);
+  for (k=0;k<nComments;k++)
+    size += strlen(comments[k].text) + 4;
+  buf = (char *) tagAlloc(CodeGenMem,size);
+  k = 0;
+  for (loc=0;loc<=highEmitLoc;loc++)
+  { Instr * i;
+    for (;k<nComments && comments[k].loc<=loc;k++)
+      len += sprintf(buf+len,"* %s\n",comments[k].text);
+    if (loc == highEmitLoc || instrs[loc].op == NULL)
+      continue;
+    i = &instrs[loc];
+    if (i->isRO)
+      len += sprintf(buf+len,"%3d:  %5s  %d,%d,%d ",loc,i->op,i->r,i->s,i->t);
+    else
+      len += sprintf(buf+len,"%3d:  %5s  %d,%d(%d) ",loc,i->op,i->r,i->t,i->s);
+    if (TraceCode) len += sprintf(buf+len,"\t%s",i->comment) ;
+    buf[len++] = '\n';
+  }
+  fwrite(buf,1,len,code);
+  free(buf);
+  for (k=0;k<nComments;k++)
+    free(comments[k].text);
+  nComments = 0;
+  for (loc=0;loc<highEmitLoc;loc++)
+    instrs[loc].op = NULL;
+  emitLoc = highEmitLoc = 0;
+} /* emitFlush */
@@ -0,0 +1,158 @@
+/****************************************************/
+/* File: diag.c                                     */
+/* Diagnostics collector implementation for the     */
+/* C-minus compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "diag.h"
+#include "stats.h"
+
+/* Diag is one recorded error */
+typedef struct
+   { DiagKind kind;
+     int lineno;
+     char * message;
+     char * name;    /* symbol errors only */
+     int decl;       /* its declaration (see diagNextDecl) */
+     int repeats;    /* later errors folded into it */
+   } Diag;
+
+static Diag * diags = NULL;
+static int nDiags = 0, diagsSize = 0;
+
+/* the errors before flushed have been written */
+static int flushed = 0;
+
+/* number of the declaration being analyzed */
+static int curDecl = 0;
+
+/* TRUE once the error limit was reported */
+static int limitNoted = FALSE;
+
+/* open hash table of indices into diags, keyed
+ * by what makes two errors repeats; -1 is empty
+ */
+static int * table = NULL;
+static int tableSize = 0;
+
+static unsigned long hashString(unsigned long h, const char * s)
+{ while (*s != '\0')
+    h = (h ^ (unsigned char) *s++) * 1099511628211UL;
+  return h;
+}
+
+static unsigned long diagHash(DiagKind kind, int lineno, char * message, char * name)
+{ unsigned long h = 14695981039346656037UL ^ kind;
+  if (kind == TypeDiag)
+    h = hashString((h ^ (unsigned long) lineno) * 1099511628211UL,message);
+  else
+    h = hashString(hashString(h,message),name);
+  return h ^ (h >> 29);
+}
+
+static int sameDiag(Diag * d, DiagKind kind, int lineno, char * message, char * name)
+{ if (d->kind != kind)
+    return FALSE;
+  if (kind == TypeDiag)
+    return d->lineno == lineno && strcmp(d->message,message) == 0;
+  return strcmp(d->message,message) == 0 && strcmp(d->name,name) == 0 &&
+         (d->decl == curDecl || d->lineno == lineno);
+}
+
+/* growTable doubles the hash table and enters
+ * the recorded errors again
+ */
+static void growTable(void)
+{ int i, j;
+  free(table);
+  tableSize = tableSize ? 2*tableSize : 64;
+  table = (int *) tagAlloc(AnalyzeMem,tableSize * sizeof(int));
+  for (i=0;i<tableSize;i++)
+    table[i] = -1;
+  for (i=0;i<nDiags;i++)
+  { Diag * d = &diags[i];
+    j = (int) (diagHash(d->kind,d->lineno,d->message,d->name) & (tableSize-1));
+    while (table[j] >= 0)
+      j = (j+1) & (tableSize-1);
+    table[j] = i;
+  }
+}
+
+void diagError(DiagKind kind, int lineno, char * message, char * name)
+{ int j;
+  Error = TRUE;
+  if (name == NULL)
+    name = "";
+  if (2*(nDiags+1) > tableSize)
+    growTable();
+  j = (int) (diagHash(kind,lineno,message,name) & (tableSize-1));
+  while (table[j] >= 0)
+  { if (sameDiag(&diags[table[j]],kind,lineno,message,name))
+    { diags[table[j]].repeats++;
+      return;
+    }
+    j = (j+1) & (tableSize-1);
+  }
+  if (diagLimitReached())
+    return;
+  if (nDiags == diagsSize)
+  { diagsSize = diagsSize ? 2*diagsSize : 16;
+    diags = (Diag *) tagRealloc(AnalyzeMem,diags,diagsSize * sizeof(Diag));
+  }
+  diags[nDiags].kind = kind;
+  diags[nDiags].lineno = lineno;
+  diags[nDiags].message = message;
+  diags[nDiags].name = name;
+  diags[nDiags].decl = curDecl;
+  diags[nDiags].repeats = 0;
+  table[j] = nDiags++;
+}
+
+void diagNextDecl(void)
+{ curDecl++;
+}
+
+int diagLimitReached(void)
+{ return ErrorLimit > 0 && nDiags >= ErrorLimit;
+}
+
+void diagFlush(void)
+{ char * buf;
+  long len = 0, size = 128;
+  int i;
+  for (i=flushed;i<nDiags;i++)
+    size += strlen(diags[i].message) + strlen(diags[i].name) + 64;
+  buf = (char *) tagAlloc(AnalyzeMem,size);
+  for (i=flushed;i<nDiags;i++)
+  { Diag * d = &diags[i];
+    if (d->kind == SymbolDiag)
+      len += sprintf(buf+len,"error: %s \"%s\" at line %d",
+                     d->message,d->name,d->lineno);
+    else
+      len += sprintf(buf+len,"Type error at line %d: %s",
+                     d->lineno,d->message);
+    if (d->repeats > 0)
+      len += sprintf(buf+len," (%d more not shown)",d->repeats);
+    buf[len++] = '\n';
+  }
+  flushed = nDiags;
+  if (diagLimitReached() && !limitNoted)
+  { len += sprintf(buf+len,"error: too many errors (limit %d), analysis stopped\n",
+                   ErrorLimit);
+    limitNoted = TRUE;
+  }
+  if (len > 0)
+    fwrite(buf,1,len,listing);
+  free(buf);
+}
+
+void diagReset(void)
+{ int i;
+  nDiags = 0;
+  flushed = 0;
+  limitNoted = FALSE;
+  curDecl = 0;
+  for (i=0;i<tableSize;i++)
+    table[i] = -1;
+}
@@ -0,0 +1,47 @@
+/****************************************************/
+/* File: diag.h                                     */
+/* Diagnostics collector for the C-minus compiler:  */
+/* errors are buffered, repeats are folded, and the */
+/* report is written all at once                    */
+/****************************************************/
+
+#ifndef _DIAG_H_
+#define _DIAG_H_
+
+/* the kinds of semantic errors */
+typedef enum {SymbolDiag,TypeDiag} DiagKind;
+
+/* Procedure diagError records an error of kind kind
+ * at line lineno; name is the symbol of a symbol
+ * error. A symbol error repeating the message and
+ * name of an earlier one of the same declaration
+ * or line, and a type error repeating the message
+ * of an earlier one on its line, are counted
+ * against the first and not reported. Once ErrorLimit
+ * errors are recorded the rest are dropped.
+ * Must be called from one thread only
+ */
+void diagError(DiagKind kind, int lineno, char * message, char * name);
+
+/* Procedure diagNextDecl starts the errors of the
+ * next top-level declaration (see diagError)
+ */
+void diagNextDecl(void);
+
+/* Function diagLimitReached returns TRUE once
+ * ErrorLimit errors have been recorded
+ */
+int diagLimitReached(void);
+
+/* Procedure diagFlush writes the errors recorded
+ * since the last flush, and a note once the limit
+ * is reached, to the listing in a single write
+ */
+void diagFlush(void);
+
+/* Procedure diagReset forgets all errors, for a new
+ * compilation of the program
+ */
+void diagReset(void);
+
+#endif
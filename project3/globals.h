@@ -71,6 +71,17 @@ typedef enum {VarK,ArrVarK,ParamK,ArrParamK,FuncK,CompK,IfK,WhileK,
               ReturnK,AssignK,CallK,TypeK} StmtKind;
 typedef enum {OpK,ConstK,IdK,NullParamK,UnknownK} ExpKind;
 
+/* NodeType numbers the kinds of both node kinds:
+ * the statement kinds, then the expression kinds,
+ * in the order above. It indexes visitor tables
+ */
+typedef enum {VarT,ArrVarT,ParamT,ArrParamT,FuncT,CompT,IfT,WhileT,
+              ReturnT,AssignT,CallT,TypeT,
+              OpT,ConstT,IdT,NullParamT,UnknownT,NODETYPES} NodeType;
+
+/* nodeType(t) is the NodeType of node t */
+#define nodeType(t) ((NodeType) ((t)->nodekind * OpT + (int) (t)->kind.stmt))
+
 /* ExpType is used for type checking */
 typedef enum {Void,Integer} ExpType;
 
@@ -81,6 +92,23 @@ typedef struct ArrInfo {
   char * name;
 } ArrInfo;
 
+/* source span of a function body skipped by a
+ * lazy parse (offsets of its braces), or of a
+ * top-level declaration; lineno is the line of
+ * its first character. The hash of a declaration
+ * mixes its tokens and their lines relative to
+ * lineno, leaving out the declared name; it is 0
+ * if the declaration has a skipped body
+ */
+typedef struct SourceSpan
+   { long start;
+     long end;
+     int lineno;
+     unsigned long hash;
+   } SourceSpan;
+
+typedef SourceSpan LazyBody;
+
 typedef struct treeNode
    { struct treeNode * child[MAXCHILDREN];
      struct treeNode * sibling;
@@ -90,6 +118,8 @@ typedef struct treeNode
 	 int param_size;
 	 int * param_list; // INTEGER or INTEGERARRAY
 	 int is_argu;
+	 LazyBody * lazy_body; // FuncK whose body is not parsed yet
+	 struct BucketListRec * symbol; // declared or referenced symbol
      NodeKind nodekind;
      union { StmtKind stmt; ExpKind exp;} kind;
      union { TokenType op;
@@ -99,6 +129,13 @@ typedef struct treeNode
      ExpType type; /* for type checking of exps */
    } TreeNode;
 
+/* type_spec does not allocate a TypeK node: var_type
+ * of every declaration points to one of these shared
+ * nodes, so equal types have equal var_type pointers
+ */
+extern TreeNode voidTypeNode;
+extern TreeNode intTypeNode;
+
 /**************************************************/
 /***********   Flags for tracing       ************/
 /**************************************************/
@@ -131,6 +168,79 @@ extern int TraceAnalyze;
  */
 extern int TraceCode;
 
+/* TraceIR = TRUE causes the three-address code of
+ * each function to be printed to the listing file
+ * before it is translated to TM code
+ */
+extern int TraceIR;
+
+/**************************************************/
+/***********   Front end options       ************/
+/**************************************************/
+
+/* AstCache = TRUE makes the front end reuse the
+ * syntax tree stored for identical source text
+ * instead of scanning and parsing it again
+ */
+extern int AstCache;
+
+/* PushParse = TRUE makes the front end scan and
+ * parse the source chunk by chunk as it arrives
+ * (e.g. through a pipe) instead of pulling tokens
+ */
+extern int PushParse;
+
+/* LazyBodies = TRUE makes the parser skip function
+ * bodies by brace matching; each body is parsed
+ * when the analyzer first reaches its function
+ */
+extern int LazyBodies;
+
+/* DeclsOnly = TRUE stops after listing the global
+ * declarations and function signatures, without
+ * ever parsing function bodies
+ */
+extern int DeclsOnly;
+
+/* FusedAnalysis = TRUE builds the symbol table and
+ * checks types in a single traversal of the tree
+ */
+extern int FusedAnalysis;
+
+/* Jobs > 0 makes the fused analysis check function
+ * bodies in parallel on Jobs threads
+ */
+extern int Jobs;
+
+/* Watch = TRUE makes the compiler check the source
+ * again each time the file changes, reusing the
+ * analysis of the functions that did not change
+ */
+extern int Watch;
+
+/* TimeReport = TIME_TABLE or TIME_JSON (see stats.h)
+ * makes the compiler report the time of each phase,
+ * its token, node, symbol and scope counts and the
+ * counts of what the optimizations did
+ */
+extern int TimeReport;
+
+/* MemReport = TRUE makes the compiler report at exit
+ * the memory allocated by each subsystem and its
+ * peak resident set size
+ */
+extern int MemReport;
+
+/* ErrorLimit is the number of errors after which
+ * analysis stops; 0 means no limit
+ */
+extern int ErrorLimit;
+
+/* Optimize = FALSE turns off the optimization of
+ * the generated code
+ */
+extern int Optimize;
+
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error; 
 #endif
@@ -0,0 +1,730 @@
+/****************************************************/
+/* File: ir.c                                       */
+/* Three-address code implementation for the        */
+/* C-minus compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "ir.h"
+#include "stats.h"
+
+/* the function being built, and the block its code
+ * is added to
+ */
+static IrFunc * fn;
+static int cur;
+
+/* the source line of the code being built */
+static int line;
+
+/* growBlocks makes room for one more block in f */
+static void growBlocks(IrFunc * f)
+{ if (f->nBlocks == f->blocksSize)
+  { f->blocksSize = f->blocksSize ? 2*f->blocksSize : 16;
+    f->blocks = (IrBlock *) tagRealloc(CodeGenMem,f->blocks,
+                                       f->blocksSize * sizeof(IrBlock));
+  }
+}
+
+static int newBlock(void)
+{ growBlocks(fn);
+  memset(&fn->blocks[fn->nBlocks],0,sizeof(IrBlock));
+  return fn->nBlocks++;
+}
+
+static int newTemp(void)
+{ return fn->nTemps++;
+}
+
+/* add appends an instruction to block b */
+static IrInstr * add(int b, IrOp op, int dst, int a, int c)
+{ IrBlock * p = &fn->blocks[b];
+  IrInstr * i;
+  if (p->nCode == p->codeSize)
+  { p->codeSize = p->codeSize ? 2*p->codeSize : 8;
+    p->code = (IrInstr *) tagRealloc(CodeGenMem,p->code,
+                                     p->codeSize * sizeof(IrInstr));
+  }
+  i = &p->code[p->nCode++];
+  i->op = op;
+  i->dst = dst;
+  i->a = a;
+  i->b = c;
+  i->val = 0;
+  i->target[0] = i->target[1] = -1;
+  i->sym = NULL;
+  i->lineno = line;
+  return i;
+}
+
+static IrInstr * last(int b)
+{ IrBlock * p = &fn->blocks[b];
+  return p->nCode > 0 ? &p->code[p->nCode-1] : NULL;
+}
+
+static int isEnd(IrInstr * i)
+{ return i != NULL &&
+         (i->op == IrJump || i->op == IrBranch || i->op == IrRet);
+}
+
+/* jump ends block from, unless it has ended, with a
+ * jump to block to
+ */
+static void jump(int from, int to)
+{ if (!isEnd(last(from)))
+    add(from,IrJump,-1,-1,-1)->target[0] = to;
+}
+
+/* the code of a function body is built by frames
+ * kept on a stack instead of by recursion, so deep
+ * nesting does not grow the C call stack. A frame
+ * builds a statement list, a statement, an
+ * expression or the branch of a condition, one
+ * step at a time; a step may push a frame for a
+ * part of its node and go on once that is built
+ */
+typedef enum {GenList,GenStmt,GenExp,GenCond} GenKind;
+
+typedef struct
+   { GenKind kind;
+     TreeNode * node;  /* its node; for a list, the next statement */
+     int step;
+     int a, b;         /* temps and blocks kept between steps */
+     int wanted;       /* of a call: its value is used */
+     int * args;       /* of a call: the argument temps */
+     TreeNode * arg;   /* of a call: the next argument */
+   } GenFrame;
+
+static GenFrame * frames = NULL;
+static int top, framesSize = 0;
+
+/* result is the temp of the expression built
+ * last, or -1
+ */
+static int result;
+
+static void push(GenKind kind, TreeNode * t)
+{ GenFrame * f;
+  if (top == framesSize)
+  { framesSize = framesSize ? 2*framesSize : 64;
+    frames = (GenFrame *) tagRealloc(CodeGenMem,frames,framesSize * sizeof(GenFrame));
+  }
+  f = &frames[top++];
+  f->kind = kind;
+  f->node = t;
+  f->step = 0;
+  f->wanted = TRUE;
+  f->args = NULL;
+  f->arg = NULL;
+}
+
+/* element computes the address of the array
+ * element of id node t at index temp i
+ */
+static int element(TreeNode * t, int i)
+{ int a = newTemp(), d = newTemp();
+  add(cur,IrAddr,a,-1,-1)->sym = t->symbol;
+  add(cur,IrBin,d,a,i)->val = PLUS;
+  return d;
+}
+
+/* stepAssign builds assignment t; its result is
+ * the value assigned
+ */
+static void stepAssign(GenFrame * f)
+{ TreeNode * t = f->node, * var = t->child[0];
+  if (f->step == 0)
+  { f->step = 1;
+    push(GenExp,var->child[0] != NULL ? var->child[0] : t->child[1]);
+    return;
+  }
+  if (var->child[0] != NULL && f->step == 1)
+  { f->a = element(var,result);
+    f->step = 2;
+    push(GenExp,t->child[1]);
+    return;
+  }
+  if (var->child[0] != NULL)
+    add(cur,IrStoreI,-1,f->a,result);
+  else
+    add(cur,IrStore,-1,result,-1)->sym = var->symbol;
+  top--;
+}
+
+/* stepCall builds call t; its result is the value
+ * returned, or -1 if it is not wanted
+ */
+static void stepCall(GenFrame * f)
+{ TreeNode * t = f->node, * p;
+  int k, d = -1;
+  if (strcmp(t->attr.name,"input") == 0)
+  { result = newTemp();
+    add(cur,IrIn,result,-1,-1);
+    top--;
+    return;
+  }
+  if (strcmp(t->attr.name,"output") == 0)
+  { if (f->step == 0)
+    { f->step = 1;
+      push(GenExp,t->child[0]);
+      return;
+    }
+    add(cur,IrOut,-1,result,-1);
+    result = -1;
+    top--;
+    return;
+  }
+  /* all arguments are computed before any is
+   * stored, so a call among them does not reuse
+   * the record being built
+   */
+  if (f->step == 0)
+  { for (p=t->child[0],k=0;p!=NULL;p=p->sibling)
+      k++;
+    f->args = (int *) tagAlloc(CodeGenMem,(k+1) * sizeof(int));
+    f->a = 0;
+    f->arg = t->child[0];
+    f->step = 1;
+  }
+  else
+    f->args[f->a++] = result;
+  if (f->arg != NULL)
+  { p = f->arg;
+    f->arg = p->sibling;
+    push(GenExp,p);
+    return;
+  }
+  line = t->lineno;
+  for (k=0;k<f->a;k++)
+    add(cur,IrArg,-1,f->args[k],-1)->val = k;
+  free(f->args);
+  if (f->wanted)
+    d = newTemp();
+  add(cur,IrCall,d,-1,-1)->sym = t->symbol;
+  result = d;
+  top--;
+}
+
+static void stepExp(GenFrame * f)
+{ TreeNode * t = f->node;
+  int a, d;
+  if (f->step == 0)
+    line = t->lineno;
+  switch (nodeType(t))
+  { case ConstT:
+      result = newTemp();
+      add(cur,IrConst,result,-1,-1)->val = t->attr.val;
+      break;
+    case IdT:
+      if (t->child[0] == NULL)
+      { result = newTemp();
+        add(cur,t->is_array ? IrAddr : IrLoad,result,-1,-1)->sym = t->symbol;
+        break;
+      }
+      if (f->step == 0)
+      { f->step = 1;
+        push(GenExp,t->child[0]);
+        return;
+      }
+      a = element(t,result);
+      result = newTemp();
+      add(cur,IrLoadI,result,a,-1);
+      break;
+    case OpT:
+      if (f->step == 0)
+      { f->step = 1;
+        push(GenExp,t->child[0]);
+        return;
+      }
+      if (f->step == 1)
+      { f->a = result;
+        f->step = 2;
+        push(GenExp,t->child[1]);
+        return;
+      }
+      d = newTemp();
+      line = t->lineno;
+      add(cur,IrBin,d,f->a,result)->val = t->attr.op;
+      result = d;
+      break;
+    case AssignT:
+      stepAssign(f);
+      return;
+    case CallT:
+      stepCall(f);
+      return;
+    default:
+      result = -1;
+      break;
+  }
+  top--;
+}
+
+static int isRelop(int op)
+{ return op == LT || op == LE || op == GT || op == GE ||
+         op == EQ || op == NE;
+}
+
+/* stepCond ends block cur with a branch whose
+ * target[0] is taken when condition t is false. A
+ * comparison is not turned into 0 or 1: the branch
+ * tests the difference of its operands, or the left
+ * one when the right is 0
+ */
+static void stepCond(GenFrame * f)
+{ TreeNode * t = f->node;
+  int d, op = EQ;
+  if (nodeType(t) == OpT && isRelop(t->attr.op))
+  { if (f->step == 0)
+    { f->step = 1;
+      push(GenExp,t->child[0]);
+      return;
+    }
+    if (f->step == 1 &&
+        !(nodeType(t->child[1]) == ConstT && t->child[1]->attr.val == 0))
+    { f->a = result;
+      f->step = 2;
+      push(GenExp,t->child[1]);
+      return;
+    }
+    if (f->step == 1)
+      d = result;
+    else
+    { d = newTemp();
+      line = t->lineno;
+      add(cur,IrBin,d,f->a,result)->val = MINUS;
+    }
+    op = irNegate(t->attr.op);
+  }
+  else
+  { if (f->step == 0)
+    { f->step = 1;
+      push(GenExp,t);
+      return;
+    }
+    d = result;
+  }
+  add(cur,IrBranch,-1,d,-1)->val = op;
+  top--;
+}
+
+static void stepStmt(GenFrame * f)
+{ TreeNode * t = f->node;
+  int c;
+  if (f->step == 0)
+    line = t->lineno;
+  switch (nodeType(t))
+  { case CompT:
+      f->kind = GenList;
+      f->node = t->child[1];
+      return;
+    case IfT:
+      /* a is the test block, b the end of the then
+       * part
+       */
+      switch (f->step)
+      { case 0:
+          f->step = 1;
+          push(GenCond,t->child[0]);
+          return;
+        case 1:
+          f->a = cur;
+          cur = newBlock();
+          last(f->a)->target[1] = cur;
+          f->step = 2;
+          push(GenList,t->child[1]);
+          return;
+        case 2:
+          if (t->child[2] != NULL)
+          { f->b = cur;
+            cur = newBlock();
+            last(f->a)->target[0] = cur;
+            f->step = 3;
+            push(GenList,t->child[2]);
+            return;
+          }
+          c = newBlock();
+          last(f->a)->target[0] = c;
+          break;
+        default:
+          c = newBlock();
+          jump(f->b,c);
+          break;
+      }
+      jump(cur,c);
+      cur = c;
+      break;
+    case WhileT:
+      /* the loop is rotated: the test is made once
+       * before it, and again at the end of the body,
+       * where a branch goes back to the body; so an
+       * iteration takes one branch, not two. a is
+       * the block of the first test, b the body
+       */
+      switch (f->step)
+      { case 0:
+          f->step = 1;
+          push(GenCond,t->child[0]);
+          return;
+        case 1:
+          f->a = cur;
+          f->b = newBlock();
+          last(f->a)->target[1] = f->b;
+          cur = f->b;
+          f->step = 2;
+          push(GenList,t->child[1]);
+          return;
+        case 2:
+          f->step = 3;
+          push(GenCond,t->child[0]);
+          return;
+      }
+      last(cur)->target[1] = f->b;
+      c = newBlock();
+      last(f->a)->target[0] = c;
+      last(cur)->target[0] = c;
+      cur = c;
+      break;
+    case ReturnT:
+      if (f->step == 0 && t->child[0] != NULL)
+      { f->step = 1;
+        push(GenExp,t->child[0]);
+        return;
+      }
+      add(cur,IrRet,-1,t->child[0] != NULL ? result : -1,-1);
+      /* the code after a return is unreachable */
+      cur = newBlock();
+      break;
+    case AssignT:
+    case CallT:
+      f->kind = GenExp;
+      f->wanted = FALSE;
+      return;
+    default:
+      if (t->nodekind == ExpK)
+      { f->kind = GenExp;
+        return;
+      }
+      break;
+  }
+  top--;
+}
+
+static void stepList(GenFrame * f)
+{ TreeNode * t = f->node;
+  if (t == NULL)
+  { top--;
+    return;
+  }
+  f->node = t->sibling;
+  push(GenStmt,t);
+}
+
+IrFunc * irBuild(TreeNode * func)
+{ fn = (IrFunc *) tagCalloc(CodeGenMem,1,sizeof(IrFunc));
+  fn->tree = func;
+  fn->sym = func->symbol;
+  cur = newBlock();
+  top = 0;
+  push(GenList,func->child[1]);
+  while (top > 0)
+  { GenFrame * f = &frames[top-1];
+    switch (f->kind)
+    { case GenList: stepList(f); break;
+      case GenStmt: stepStmt(f); break;
+      case GenExp: stepExp(f); break;
+      case GenCond: stepCond(f); break;
+    }
+  }
+  free(frames);
+  frames = NULL;
+  framesSize = 0;
+  /* falling off the end returns */
+  if (!isEnd(last(cur)))
+    add(cur,IrRet,-1,-1,-1);
+  irCfg(fn);
+  return fn;
+}
+
+/* markReached marks the blocks reached from the
+ * entry, keeping the blocks to follow on a stack
+ */
+static void markReached(IrFunc * f, int * map)
+{ int * stack = (int *) tagAlloc(CodeGenMem,(f->nBlocks+1) * sizeof(int));
+  int top = 0, k;
+  map[0] = 1;
+  stack[top++] = 0;
+  while (top > 0)
+  { IrBlock * p = &f->blocks[stack[--top]];
+    IrInstr * i = &p->code[p->nCode-1];
+    if (i->op == IrRet)
+      continue;
+    for (k=i->op == IrBranch ? 1 : 0;k>=0;k--)
+      if (map[i->target[k]] < 0)
+      { map[i->target[k]] = 1;
+        stack[top++] = i->target[k];
+      }
+  }
+  free(stack);
+}
+
+void irCfg(IrFunc * f)
+{ int * map = (int *) tagAlloc(CodeGenMem,f->nBlocks * sizeof(int));
+  int b, n = 0, k;
+  for (b=0;b<f->nBlocks;b++)
+    map[b] = -1;
+  markReached(f,map);
+  for (b=0;b<f->nBlocks;b++)
+  { IrBlock * p = &f->blocks[b];
+    free(p->pred);
+    p->pred = NULL;
+    if (map[b] < 0)
+    { free(p->code);
+      free(p->liveIn);
+      free(p->liveOut);
+      continue;
+    }
+    map[b] = n;
+    f->blocks[n++] = *p;
+  }
+  f->nBlocks = n;
+  for (b=0;b<n;b++)
+  { IrBlock * p = &f->blocks[b];
+    IrInstr * i = &p->code[p->nCode-1];
+    p->nSucc = 0;
+    p->nPred = 0;
+    for (k=0;k<2;k++)
+      if (i->target[k] >= 0)
+      { i->target[k] = map[i->target[k]];
+        p->succ[p->nSucc++] = i->target[k];
+      }
+  }
+  for (b=0;b<n;b++)
+    for (k=0;k<f->blocks[b].nSucc;k++)
+      f->blocks[f->blocks[b].succ[k]].nPred++;
+  for (b=0;b<n;b++)
+  { f->blocks[b].pred = (int *) tagAlloc(CodeGenMem,
+                          (f->blocks[b].nPred+1) * sizeof(int));
+    f->blocks[b].nPred = 0;
+  }
+  for (b=0;b<n;b++)
+    for (k=0;k<f->blocks[b].nSucc;k++)
+    { IrBlock * s = &f->blocks[f->blocks[b].succ[k]];
+      s->pred[s->nPred++] = b;
+    }
+  free(map);
+}
+
+int * irInsertBlocks(IrFunc * f, const int * before)
+{ int * map = (int *) tagAlloc(CodeGenMem,(f->nBlocks+1) * sizeof(int));
+  IrBlock * blocks;
+  int b, k, n = 0;
+  for (b=0;b<f->nBlocks;b++)
+  { if (before[b])
+      n++;
+    map[b] = b + n;
+  }
+  blocks = (IrBlock *) tagCalloc(CodeGenMem,f->nBlocks + n + 1,sizeof(IrBlock));
+  for (b=0;b<f->nBlocks;b++)
+  { IrBlock * p = &f->blocks[b];
+    for (k=0;k<p->nCode;k++)
+    { IrInstr * i = &p->code[k];
+      if (i->target[0] >= 0) i->target[0] = map[i->target[0]];
+      if (i->target[1] >= 0) i->target[1] = map[i->target[1]];
+    }
+    blocks[map[b]] = *p;
+  }
+  free(f->blocks);
+  f->blocks = blocks;
+  f->nBlocks += n;
+  f->blocksSize = f->nBlocks + 1;
+  return map;
+}
+
+void irInsert(IrFunc * f, int b, int k, IrInstr * i)
+{ IrBlock * p = &f->blocks[b];
+  fn = f;
+  add(b,i->op,-1,-1,-1);
+  memmove(&p->code[k+1],&p->code[k],(p->nCode - 1 - k) * sizeof(IrInstr));
+  p->code[k] = *i;
+}
+
+int irNegate(int op)
+{ switch (op)
+  { case LT : return GE;
+    case LE : return GT;
+    case GT : return LE;
+    case GE : return LT;
+    case EQ : return NE;
+    default : return EQ;
+  }
+}
+
+int irUses(IrInstr * i, int uses[2])
+{ int n = 0;
+  if (i->a >= 0) uses[n++] = i->a;
+  if (i->b >= 0) uses[n++] = i->b;
+  return n;
+}
+
+void irLiveness(IrFunc * f)
+{ int words, b, k, w, t, changed = TRUE;
+  int * defBlock = (int *) tagAlloc(CodeGenMem,(f->nTemps+1) * sizeof(int));
+  int * defPos = (int *) tagAlloc(CodeGenMem,(f->nTemps+1) * sizeof(int));
+  int * index = (int *) tagAlloc(CodeGenMem,(f->nTemps+1) * sizeof(int));
+  unsigned * gen, * kill;
+  for (t=0;t<f->nTemps;t++)
+  { defBlock[t] = -1;
+    index[t] = -1;
+  }
+  for (b=0;b<f->nBlocks;b++)
+    for (k=0;k<f->blocks[b].nCode;k++)
+      if (f->blocks[b].code[k].dst >= 0)
+      { defBlock[f->blocks[b].code[k].dst] = b;
+        defPos[f->blocks[b].code[k].dst] = k;
+      }
+  free(f->cross);
+  f->cross = (int *) tagAlloc(CodeGenMem,(f->nTemps+1) * sizeof(int));
+  f->nCross = 0;
+  for (b=0;b<f->nBlocks;b++)
+    for (k=0;k<f->blocks[b].nCode;k++)
+    { int uses[2], n = irUses(&f->blocks[b].code[k],uses), j;
+      for (j=0;j<n;j++)
+      { t = uses[j];
+        if (index[t] < 0 && (defBlock[t] != b || defPos[t] >= k))
+        { index[t] = f->nCross;
+          f->cross[f->nCross++] = t;
+        }
+      }
+    }
+  words = IRWORDS(f->nCross);
+  gen = (unsigned *) tagCalloc(CodeGenMem,(size_t) f->nBlocks * words + 1,sizeof(unsigned));
+  kill = (unsigned *) tagCalloc(CodeGenMem,(size_t) f->nBlocks * words + 1,sizeof(unsigned));
+  for (b=0;b<f->nBlocks;b++)
+  { IrBlock * p = &f->blocks[b];
+    unsigned * g = gen + b * words, * d = kill + b * words;
+    free(p->liveIn);
+    free(p->liveOut);
+    p->liveIn = (unsigned *) tagCalloc(CodeGenMem,words+1,sizeof(unsigned));
+    p->liveOut = (unsigned *) tagCalloc(CodeGenMem,words+1,sizeof(unsigned));
+    /* the temps read before they are set */
+    for (k=0;k<p->nCode;k++)
+    { int uses[2], n = irUses(&p->code[k],uses), j;
+      for (j=0;j<n;j++)
+      { int x = index[uses[j]];
+        if (x >= 0 && !irHas(d,x))
+          g[x / IRBITS] |= 1u << (x % IRBITS);
+      }
+      t = p->code[k].dst;
+      if (t >= 0 && index[t] >= 0)
+        d[index[t] / IRBITS] |= 1u << (index[t] % IRBITS);
+    }
+  }
+  while (changed)
+  { changed = FALSE;
+    for (b=f->nBlocks-1;b>=0;b--)
+    { IrBlock * p = &f->blocks[b];
+      for (w=0;w<words;w++)
+      { unsigned out = 0, in;
+        for (k=0;k<p->nSucc;k++)
+          out |= f->blocks[p->succ[k]].liveIn[w];
+        in = gen[b*words+w] | (out & ~kill[b*words+w]);
+        if (in != p->liveIn[w] || out != p->liveOut[w])
+        { p->liveIn[w] = in;
+          p->liveOut[w] = out;
+          changed = TRUE;
+        }
+      }
+    }
+  }
+  free(defBlock);
+  free(defPos);
+  free(index);
+  free(gen);
+  free(kill);
+}
+
+static char * opName(int op)
+{ switch (op)
+  { case PLUS: return "+";
+    case MINUS: return "-";
+    case TIMES: return "*";
+    case OVER: return "/";
+    case LT: return "<";
+    case LE: return "<=";
+    case GT: return ">";
+    case GE: return ">=";
+    case EQ: return "==";
+    case NE: return "!=";
+    default: return "?";
+  }
+}
+
+static void dumpInstr(FILE * out, IrInstr * i)
+{ fprintf(out,"  ");
+  switch (i->op)
+  { case IrConst: fprintf(out,"t%d = %d",i->dst,i->val); break;
+    case IrLoad: fprintf(out,"t%d = %s",i->dst,i->sym->name); break;
+    case IrStore: fprintf(out,"%s = t%d",i->sym->name,i->a); break;
+    case IrAddr: fprintf(out,"t%d = &%s",i->dst,i->sym->name); break;
+    case IrLoadI: fprintf(out,"t%d = *t%d",i->dst,i->a); break;
+    case IrStoreI: fprintf(out,"*t%d = t%d",i->a,i->b); break;
+    case IrBin:
+      fprintf(out,"t%d = t%d %s t%d",i->dst,i->a,opName(i->val),i->b);
+      break;
+    case IrCopy: fprintf(out,"t%d = t%d",i->dst,i->a); break;
+    case IrArg: fprintf(out,"arg %d = t%d",i->val,i->a); break;
+    case IrCall:
+      if (i->dst >= 0) fprintf(out,"t%d = ",i->dst);
+      fprintf(out,"call %s",i->sym->name);
+      break;
+    case IrIn: fprintf(out,"t%d = input",i->dst); break;
+    case IrOut: fprintf(out,"output t%d",i->a); break;
+    case IrJump: fprintf(out,"goto B%d",i->target[0]); break;
+    case IrBranch:
+      fprintf(out,"if t%d %s 0 goto B%d else B%d",i->a,opName(i->val),
+              i->target[0],i->target[1]);
+      break;
+    case IrRet:
+      fprintf(out,"return");
+      if (i->a >= 0) fprintf(out," t%d",i->a);
+      break;
+  }
+  fprintf(out,"\n");
+}
+
+void irDump(FILE * out, IrFunc * f)
+{ int b, k;
+  fprintf(out,"\nfunction %s: %d blocks, %d temps\n",
+          f->sym->name,f->nBlocks,f->nTemps);
+  for (b=0;b<f->nBlocks;b++)
+  { IrBlock * p = &f->blocks[b];
+    fprintf(out,"B%d:",b);
+    if (p->nPred > 0)
+    { fprintf(out," <-");
+      for (k=0;k<p->nPred;k++) fprintf(out," B%d",p->pred[k]);
+    }
+    if (p->nSucc > 0)
+    { fprintf(out," ->");
+      for (k=0;k<p->nSucc;k++) fprintf(out," B%d",p->succ[k]);
+    }
+    fprintf(out,"\n");
+    for (k=0;k<p->nCode;k++)
+      dumpInstr(out,&p->code[k]);
+  }
+}
+
+void irFree(IrFunc * f)
+{ int b;
+  for (b=0;b<f->nBlocks;b++)
+  { free(f->blocks[b].code);
+    free(f->blocks[b].pred);
+    free(f->blocks[b].liveIn);
+    free(f->blocks[b].liveOut);
+  }
+  free(f->blocks);
+  free(f->cross);
+  free(f);
+}
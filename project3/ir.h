@@ -0,0 +1,132 @@
+/****************************************************/
+/* File: ir.h                                       */
+/* Three-address code for the C-minus compiler:     */
+/* the instructions of a function are kept in basic */
+/* blocks linked into a control-flow graph          */
+/****************************************************/
+
+#ifndef _IR_H_
+#define _IR_H_
+
+/* the three-address instructions; a value lives in
+ * a temp, numbered from 0 in each function, and is
+ * defined by exactly one instruction
+ */
+typedef enum
+   { IrConst,  /* dst = val */
+     IrLoad,   /* dst = sym */
+     IrStore,  /* sym = a */
+     IrAddr,   /* dst = address of the first element of array sym */
+     IrLoadI,  /* dst = memory[a] */
+     IrStoreI, /* memory[a] = b */
+     IrBin,    /* dst = a val b, val an operator (PLUS, LT, ...) */
+     IrCopy,   /* dst = a */
+     IrArg,    /* argument number val of the next call = a */
+     IrCall,   /* dst = call of function sym; dst may be -1 */
+     IrIn,     /* dst = input() */
+     IrOut,    /* output(a) */
+     IrJump,   /* goto target[0] */
+     IrBranch, /* if a val 0 goto target[0] else target[1] */
+     IrRet     /* return a; a may be -1 */
+   } IrOp;
+
+typedef struct
+   { IrOp op;
+     int dst;          /* temp defined, or -1 */
+     int a, b;         /* temps used, or -1 */
+     int val;
+     int target[2];    /* blocks of a jump or branch */
+     struct BucketListRec * sym;
+     int lineno;
+   } IrInstr;
+
+/* a basic block ends with its only jump, branch or
+ * return; its successors are the targets of that
+ * instruction
+ */
+typedef struct
+   { IrInstr * code;
+     int nCode, codeSize;
+     int nSucc;
+     int succ[2];
+     int * pred;
+     int nPred;
+     unsigned * liveIn;  /* cross temps live at the start (see irLiveness) */
+     unsigned * liveOut; /* cross temps live at the end */
+   } IrBlock;
+
+/* a function; block 0 is the entry, and the blocks
+ * are laid out in the TM code in their order
+ */
+typedef struct
+   { TreeNode * tree;
+     struct BucketListRec * sym;
+     IrBlock * blocks;
+     int nBlocks, blocksSize;
+     int nTemps;
+     int * cross;      /* the cross temps (see irLiveness) */
+     int nCross;
+   } IrFunc;
+
+/* a set of temps is an array of IRWORDS(n) words */
+#define IRBITS (8 * (int) sizeof(unsigned))
+#define IRWORDS(n) (((n) + IRBITS - 1) / IRBITS)
+#define irHas(set,t) (((set)[(t) / IRBITS] >> ((t) % IRBITS)) & 1u)
+
+/* Function irBuild translates the function declared
+ * at node func, which was analyzed without errors,
+ * into three-address code, and builds its control-
+ * flow graph (see irCfg)
+ */
+IrFunc * irBuild(TreeNode * func);
+
+/* Procedure irCfg computes the successors and
+ * predecessors of the blocks of f, after removing
+ * the blocks that the entry cannot reach. A pass
+ * that changes the jumps of f calls it again
+ */
+void irCfg(IrFunc * f);
+
+/* Procedure irLiveness computes the liveIn and
+ * liveOut sets of the blocks of f. Only a temp read
+ * outside the part of the block after its
+ * definition, a cross temp, can be live between
+ * blocks; the sets hold cross temp g for temp
+ * f->cross[g]
+ */
+void irLiveness(IrFunc * f);
+
+/* Function irInsertBlocks inserts an empty block
+ * before each block b of f with before[b] TRUE,
+ * renumbering the blocks and the jumps to them. It
+ * returns the new numbers of the old blocks, which
+ * the caller frees; the caller fills the new blocks
+ * and calls irCfg
+ */
+int * irInsertBlocks(IrFunc * f, const int * before);
+
+/* Procedure irInsert inserts a copy of instruction
+ * i before the instruction k of block b
+ */
+void irInsert(IrFunc * f, int b, int k, IrInstr * i);
+
+/* Function irNegate returns the comparison that
+ * is false when comparison op is true
+ */
+int irNegate(int op);
+
+/* Function irUses puts the temps read by
+ * instruction i in uses and returns their number
+ */
+int irUses(IrInstr * i, int uses[2]);
+
+/* Procedure irDump prints the code of f to file out,
+ * a line per instruction, each block headed by its
+ * number, predecessors and successors
+ */
+void irDump(FILE * out, IrFunc * f);
+
+/* Procedure irFree frees f */
+void irFree(IrFunc * f);
+
+#endif
@@ -0,0 +1,415 @@
+/****************************************************/
+/* File: licm.c                                     */
+/* Loop-invariant code motion implementation for    */
+/* the C-minus compiler                             */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "ir.h"
+#include "licm.h"
+#include "stats.h"
+
+/* the function being worked on */
+static IrFunc * fn;
+
+/* Loop is a loop of fn. A block jumps back only to
+ * the header of a loop it is in, and irBuild lays
+ * out the blocks of a loop from its header to the
+ * last block that jumps back, its latch, so a loop
+ * is that range of blocks. Loops are numbered by
+ * their headers, so an inner loop comes after the
+ * loop around it, and the loops inside loop l are
+ * l+1 to last
+ */
+typedef struct
+   { int header, latch;
+     int parent;    /* the loop around it, or -1 */
+     int last;
+     int hasCall, hasStoreI, hasRet;
+     /* the code moved out of loops in it, the code
+      * moved into their preheaders, and into its own
+      */
+     int from, below, into;
+   } Loop;
+
+static Loop * loops;
+static int nLoops;
+
+/* loopOf[b] is the innermost loop of block b, or -1 */
+static int * loopOf;
+
+/* defBlock[t] is the block that sets temp t, on
+ * line defLine[t]; temp t is a constant if
+ * isConst[t], of value constVal[t], and the address
+ * of array addrSym[t] if that is not NULL
+ */
+static int * defBlock, * defLine, * isConst, * constVal;
+static struct BucketListRec ** addrSym;
+
+/* crossedBy[b] is the last block before b with a
+ * jump past b, or -1: block b runs in each
+ * iteration of a loop with no return exactly when
+ * no block of the loop jumps past it
+ */
+static int * crossedBy;
+
+/* Store is a variable stored into in a loop; the
+ * stores of fn are sorted by variable and loop
+ */
+typedef struct
+   { struct BucketListRec * sym;
+     int loop;
+   } Store;
+
+static Store * stores;
+static int nStores;
+
+static int byVarAndLoop(const void * a, const void * b)
+{ const Store * s = (const Store *) a, * t = (const Store *) b;
+  if (s->sym != t->sym)
+    return (unsigned long) s->sym < (unsigned long) t->sym ? -1 : 1;
+  return s->loop - t->loop;
+}
+
+/* assigned tells whether loop l stores into
+ * variable s
+ */
+static int assigned(int l, struct BucketListRec * s)
+{ int lo = 0, hi = nStores;
+  while (lo < hi)
+  { int mid = (lo + hi) / 2;
+    if ((unsigned long) stores[mid].sym < (unsigned long) s ||
+        (stores[mid].sym == s && stores[mid].loop < l))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < nStores && stores[lo].sym == s && stores[lo].loop <= loops[l].last;
+}
+
+static int inLoop(int l, int b)
+{ return b >= loops[l].header && b <= loops[l].latch;
+}
+
+/* A loop is entered at its header, and a jump back
+ * to it comes from the header or a block after it
+ */
+static int latchOf(int h)
+{ int k, latch = -1;
+  for (k=0;k<fn->blocks[h].nPred;k++)
+    if (fn->blocks[h].pred[k] >= h && fn->blocks[h].pred[k] > latch)
+      latch = fn->blocks[h].pred[k];
+  return latch;
+}
+
+/* addPreheaders inserts before each loop header a
+ * block that the jumps into the loop go through
+ */
+static void addPreheaders(void)
+{ int n = fn->nBlocks, b, k;
+  int * isHeader = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  int * isNew, * map;
+  for (b=0;b<n;b++)
+    isHeader[b] = latchOf(b) >= 0;
+  map = irInsertBlocks(fn,isHeader);
+  isNew = (int *) tagCalloc(CodeGenMem,fn->nBlocks+1,sizeof(int));
+  for (b=0;b<n;b++)
+    if (isHeader[b])
+    { IrInstr jump;
+      memset(&jump,0,sizeof(IrInstr));
+      jump.op = IrJump;
+      jump.dst = jump.a = jump.b = -1;
+      jump.target[0] = map[b];
+      jump.target[1] = -1;
+      irInsert(fn,map[b]-1,0,&jump);
+      isNew[map[b]] = TRUE;
+    }
+  for (b=0;b<fn->nBlocks;b++)
+  { IrInstr * i = &fn->blocks[b].code[fn->blocks[b].nCode-1];
+    for (k=0;k<2;k++)
+      if (i->target[k] >= 0 && isNew[i->target[k]] && b < i->target[k] - 1)
+        i->target[k]--;
+  }
+  free(isHeader);
+  free(isNew);
+  free(map);
+  irCfg(fn);
+}
+
+/* findLoops numbers the loops of fn and sets their
+ * nesting, loopOf, and what the code in them does
+ */
+static void findLoops(void)
+{ int n = fn->nBlocks, b, k, l, top = 0;
+  int * open = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  loops = (Loop *) tagAlloc(CodeGenMem,(n+1) * sizeof(Loop));
+  loopOf = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  nLoops = 0;
+  for (b=0;b<n;b++)
+  { int latch = latchOf(b);
+    while (top > 0 && loops[open[top-1]].latch < b)
+      top--;
+    if (latch >= 0)
+    { Loop * p = &loops[nLoops];
+      p->header = b;
+      p->latch = latch;
+      p->parent = top > 0 ? open[top-1] : -1;
+      p->last = nLoops;
+      p->hasCall = p->hasStoreI = p->hasRet = FALSE;
+      p->from = p->below = p->into = 0;
+      open[top++] = nLoops++;
+    }
+    loopOf[b] = top > 0 ? open[top-1] : -1;
+  }
+  free(open);
+  for (b=0;b<n;b++)
+    if (loopOf[b] >= 0)
+      for (k=0;k<fn->blocks[b].nCode;k++)
+      { Loop * p = &loops[loopOf[b]];
+        switch (fn->blocks[b].code[k].op)
+        { case IrCall: p->hasCall = TRUE; break;
+          case IrStoreI: p->hasStoreI = TRUE; break;
+          case IrRet: p->hasRet = TRUE; break;
+          default: break;
+        }
+      }
+  for (l=nLoops-1;l>=0;l--)
+    if (loops[l].parent >= 0)
+    { Loop * p = &loops[loops[l].parent];
+      p->hasCall |= loops[l].hasCall;
+      p->hasStoreI |= loops[l].hasStoreI;
+      p->hasRet |= loops[l].hasRet;
+      if (loops[l].last > p->last)
+        p->last = loops[l].last;
+    }
+}
+
+/* next[b] is a block from b on whose crossedBy is
+ * not set yet, or n
+ */
+static int * next;
+
+static int unset(int b)
+{ int r = b;
+  while (next[r] != r)
+    r = next[r];
+  while (next[b] != r)
+  { int c = next[b];
+    next[b] = r;
+    b = c;
+  }
+  return r;
+}
+
+/* findCrossings sets crossedBy, taking the jumps
+ * from the last block back, so each block is set
+ * once
+ */
+static void findCrossings(void)
+{ int n = fn->nBlocks, u, v, k;
+  next = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  crossedBy = (int *) tagAlloc(CodeGenMem,(n+1) * sizeof(int));
+  for (v=0;v<=n;v++)
+  { next[v] = v;
+    crossedBy[v] = -1;
+  }
+  for (u=n-1;u>=0;u--)
+    for (k=0;k<fn->blocks[u].nSucc;k++)
+      for (v=unset(u+1);v<fn->blocks[u].succ[k];v=unset(v))
+      { crossedBy[v] = u;
+        next[v] = v + 1;
+      }
+  free(next);
+}
+
+/* runsEachTime tells whether block b of loop l runs
+ * in each iteration, so that an instruction that
+ * may trap is not moved out of a path the loop
+ * might not take
+ */
+static int runsEachTime(int l, int b)
+{ return !loops[l].hasRet && crossedBy[b] < loops[l].header;
+}
+
+/* outside tells whether temp t may be read before
+ * loop l: it is set before, or it is a constant or
+ * address, which moves along with the code that
+ * reads it
+ */
+static int outside(int l, int t)
+{ return !inLoop(l,defBlock[t]) || isConst[t] || addrSym[t] != NULL;
+}
+
+/* invariant tells whether instruction i of block b
+ * computes the same value in each iteration of loop
+ * l, around b, and may be computed before it. If it
+ * holds for a loop, it holds for the loops inside
+ */
+static int invariant(int l, IrInstr * i, int b)
+{ Loop * p = &loops[l];
+  switch (i->op)
+  { case IrLoad:
+      return !(p->hasCall && i->sym->global_order >= 0) && !assigned(l,i->sym);
+    case IrLoadI:
+      return !p->hasStoreI && !p->hasCall && outside(l,i->a) && runsEachTime(l,b);
+    case IrBin:
+      if (!outside(l,i->a) || !outside(l,i->b))
+        return FALSE;
+      /* a division may trap */
+      return i->val != OVER || (isConst[i->b] && constVal[i->b] != 0) ||
+             runsEachTime(l,b);
+    default:
+      return FALSE;
+  }
+}
+
+/* moveTo moves instruction i into preheader pre,
+ * and sets the block of its temp
+ */
+static void moveTo(IrInstr * i, int pre)
+{ defBlock[i->dst] = pre;
+  irInsert(fn,pre,fn->blocks[pre].nCode-1,i);
+}
+
+/* moveOperand moves the constant or address in
+ * temp t into preheader pre of loop l, if it is
+ * set in the loop
+ */
+static void moveOperand(int l, int t, int pre)
+{ IrInstr i;
+  if (t < 0 || !inLoop(l,defBlock[t]))
+    return;
+  memset(&i,0,sizeof(IrInstr));
+  i.op = isConst[t] ? IrConst : IrAddr;
+  i.dst = t;
+  i.a = i.b = -1;
+  i.val = isConst[t] ? constVal[t] : 0;
+  i.sym = addrSym[t];
+  i.target[0] = i.target[1] = -1;
+  i.lineno = defLine[t];
+  moveTo(&i,pre);
+}
+
+/* hoist moves each invariant into the preheader of
+ * the outermost loop it is invariant in, taking the
+ * blocks in order, so that its operands have been
+ * moved first. open holds the loops around the
+ * block, outermost first, to be searched. The code
+ * moved stays where it was, for defBlock to tell
+ * apart, until the end
+ */
+static void hoist(void)
+{ int * open = (int *) tagAlloc(CodeGenMem,(nLoops+1) * sizeof(int));
+  int b, k, n, top = 0, l = 0;
+  for (b=0;b<fn->nBlocks;b++)
+  { IrBlock * p = &fn->blocks[b];
+    while (top > 0 && loops[open[top-1]].latch < b)
+      top--;
+    if (l < nLoops && loops[l].header == b)
+      open[top++] = l++;
+    for (k=0;k<p->nCode;k++)
+    { IrInstr * i = &p->code[k];
+      int lo = top, hi = top;
+      if (i->dst >= 0 && top > 0 && invariant(open[top-1],i,b))
+      { lo = 0;
+        hi = top - 1;
+      }
+      while (lo < hi)
+      { int mid = (lo + hi) / 2;
+        if (invariant(open[mid],i,b))
+          hi = mid;
+        else
+          lo = mid + 1;
+      }
+      if (lo < top)
+      { int to = open[lo], pre = loops[to].header - 1;
+        moveOperand(to,i->a,pre);
+        moveOperand(to,i->b,pre);
+        moveTo(i,pre);
+        loops[open[top-1]].from++;
+        loops[to].into++;
+      }
+    }
+  }
+  for (b=0;b<fn->nBlocks;b++)
+  { IrBlock * p = &fn->blocks[b];
+    for (k=0,n=0;k<p->nCode;k++)
+      if (p->code[k].dst < 0 || defBlock[p->code[k].dst] == b)
+        p->code[n++] = p->code[k];
+    p->nCode = n;
+  }
+  free(open);
+}
+
+int hoistInvariants(IrFunc * f)
+{ int b, k, l, t, total = 0;
+  fn = f;
+  addPreheaders();
+  findLoops();
+  findCrossings();
+  defBlock = (int *) tagAlloc(CodeGenMem,(fn->nTemps+1) * sizeof(int));
+  isConst = (int *) tagAlloc(CodeGenMem,(fn->nTemps+1) * sizeof(int));
+  constVal = (int *) tagAlloc(CodeGenMem,(fn->nTemps+1) * sizeof(int));
+  defLine = (int *) tagAlloc(CodeGenMem,(fn->nTemps+1) * sizeof(int));
+  addrSym = (struct BucketListRec **) tagAlloc(CodeGenMem,
+              (fn->nTemps+1) * sizeof(struct BucketListRec *));
+  stores = (Store *) tagAlloc(CodeGenMem,sizeof(Store));
+  nStores = 0;
+  for (t=0;t<fn->nTemps;t++)
+  { defBlock[t] = -1;
+    isConst[t] = FALSE;
+    addrSym[t] = NULL;
+  }
+  for (b=0;b<fn->nBlocks;b++)
+    for (k=0;k<fn->blocks[b].nCode;k++)
+    { IrInstr * i = &fn->blocks[b].code[k];
+      if (i->op == IrStore && loopOf[b] >= 0)
+      { if ((nStores & (nStores-1)) == 0)
+          stores = (Store *) tagRealloc(CodeGenMem,stores,2 * (nStores+1) * sizeof(Store));
+        stores[nStores].sym = i->sym;
+        stores[nStores++].loop = loopOf[b];
+      }
+      if (i->dst < 0)
+        continue;
+      defBlock[i->dst] = b;
+      defLine[i->dst] = i->lineno;
+      if (i->op == IrConst)
+      { isConst[i->dst] = TRUE;
+        constVal[i->dst] = i->val;
+      }
+      else if (i->op == IrAddr)
+        addrSym[i->dst] = i->sym;
+    }
+  qsort(stores,nStores,sizeof(Store),byVarAndLoop);
+  hoist();
+  /* code moved out of a loop and a loop around it
+   * counts for each
+   */
+  for (l=nLoops-1;l>=0;l--)
+  { Loop * p = &loops[l];
+    if (p->parent >= 0)
+    { loops[p->parent].from += p->from;
+      loops[p->parent].below += p->below + p->into;
+    }
+    p->from -= p->below;
+    total += p->from;
+  }
+  if (TraceIR)
+    for (l=0;l<nLoops;l++)
+    { IrBlock * p = &fn->blocks[loops[l].latch];
+      fprintf(listing,"%s: loop at line %d: %d hoisted\n",fn->sym->name,
+              p->code[p->nCode-1].lineno,loops[l].from);
+    }
+  free(loops);
+  free(loopOf);
+  free(crossedBy);
+  free(defBlock);
+  free(isConst);
+  free(constVal);
+  free(defLine);
+  free(addrSym);
+  free(stores);
+  countEvent("licm ops",total);
+  return total;
+}
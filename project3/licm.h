@@ -0,0 +1,27 @@
+/****************************************************/
+/* File: licm.h                                     */
+/* Loop-invariant code motion interface for the     */
+/* C-minus compiler                                 */
+/****************************************************/
+
+#ifndef _LICM_H_
+#define _LICM_H_
+
+/* Function hoistInvariants gives each loop of f a
+ * preheader, a block that control passes through
+ * once on entering the loop, and moves into it the
+ * computations whose operands the loop does not
+ * change: a variable not assigned in the loop (nor
+ * by a call, if global), an array element if the
+ * loop stores no element and makes no call, since
+ * an array parameter may be any array, and the
+ * operators on such values. A computation leaves
+ * all the loops it is invariant in at once, for the
+ * preheader of the outermost. It returns the number
+ * of operations moved out of a loop, summed over the
+ * loops, which is also counted (see countEvent);
+ * TraceIR prints the number moved out of each loop
+ */
+int hoistInvariants(IrFunc * f);
+
+#endif
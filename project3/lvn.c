@@ -0,0 +1,242 @@
+/****************************************************/
+/* File: lvn.c                                      */
+/* Local value numbering implementation for the     */
+/* C-minus compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "ir.h"
+#include "lvn.h"
+#include "stats.h"
+
+/* Value is a value the block being numbered has in
+ * temp t: computed by an instruction op with val
+ * and sym on operands a and b. A loaded value is
+ * keyed by the versions of the memory it was read
+ * from: an IrLoad of sym by the stores into sym
+ * in val and the calls in b, an IrLoadI of address
+ * a by memVersion in b. An IrStore entry holds in
+ * t the number of stores into sym
+ */
+typedef struct
+   { IrOp op;
+     int val;
+     struct BucketListRec * sym;
+     int a, b;
+     int t;
+     int slot;  /* its place in table */
+   } Value;
+
+static Value * values = NULL;
+static int nValues, valuesSize = 0;
+
+/* open hash table of indices into values, keyed
+ * by op, val, sym, a and b; -1 is empty
+ */
+static int * table = NULL;
+static int tableSize = 0;
+
+/* the versions of the elements of all arrays and
+ * of the global variables: a store through an
+ * address changes the first, and a call both
+ */
+static int memVersion, callVersion;
+
+/* same[t] is the temp that first had the value of
+ * temp t, which reads of t read instead
+ */
+static int * same;
+
+static unsigned long hashValue(IrOp op, int val, struct BucketListRec * sym, int a, int b)
+{ unsigned long h = 14695981039346656037UL;
+  h = (h ^ (unsigned long) op) * 1099511628211UL;
+  h = (h ^ (unsigned long) val) * 1099511628211UL;
+  h = (h ^ (unsigned long) sym) * 1099511628211UL;
+  h = (h ^ (unsigned long) a) * 1099511628211UL;
+  h = (h ^ (unsigned long) b) * 1099511628211UL;
+  return h ^ (h >> 29);
+}
+
+/* findSlot returns the index in values of the key,
+ * or -1, and puts in *slot where it is or goes
+ */
+static int findSlot(IrOp op, int val, struct BucketListRec * sym,
+                    int a, int b, int * slot)
+{ int j = (int) (hashValue(op,val,sym,a,b) & (tableSize-1));
+  while (table[j] >= 0)
+  { Value * p = &values[table[j]];
+    if (p->op == op && p->val == val && p->sym == sym && p->a == a && p->b == b)
+    { *slot = j;
+      return table[j];
+    }
+    j = (j+1) & (tableSize-1);
+  }
+  *slot = j;
+  return -1;
+}
+
+static int find(IrOp op, int val, struct BucketListRec * sym, int a, int b)
+{ int slot;
+  return findSlot(op,val,sym,a,b,&slot);
+}
+
+/* growTable doubles the hash table and enters
+ * the values again
+ */
+static void growTable(void)
+{ int v, j;
+  free(table);
+  tableSize = tableSize ? 2*tableSize : 256;
+  table = (int *) tagAlloc(CodeGenMem,tableSize * sizeof(int));
+  for (j=0;j<tableSize;j++)
+    table[j] = -1;
+  for (v=0;v<nValues;v++)
+  { Value * p = &values[v];
+    findSlot(p->op,p->val,p->sym,p->a,p->b,&p->slot);
+    table[p->slot] = v;
+  }
+}
+
+/* enter enters a value, or sets the temp of the
+ * value with that key
+ */
+static void enter(IrOp op, int val, struct BucketListRec * sym,
+                  int a, int b, int t)
+{ Value * v;
+  int slot, k;
+  if (2*(nValues+1) > tableSize)
+    growTable();
+  k = findSlot(op,val,sym,a,b,&slot);
+  if (k >= 0)
+  { values[k].t = t;
+    return;
+  }
+  if (nValues == valuesSize)
+  { valuesSize = valuesSize ? 2*valuesSize : 64;
+    values = (Value *) tagRealloc(CodeGenMem,values,valuesSize * sizeof(Value));
+  }
+  v = &values[nValues];
+  v->op = op;
+  v->val = val;
+  v->sym = sym;
+  v->a = a;
+  v->b = b;
+  v->t = t;
+  v->slot = slot;
+  table[slot] = nValues++;
+}
+
+/* stores returns the number of stores into
+ * variable s so far in the block
+ */
+static int stores(struct BucketListRec * s)
+{ int v = find(IrStore,0,s,-1,-1);
+  return v >= 0 ? values[v].t : 0;
+}
+
+/* calls returns the version of variable s that a
+ * call changes: callVersion if it is global
+ */
+static int calls(struct BucketListRec * s)
+{ return s->global_order >= 0 ? callVersion : 0;
+}
+
+static int isCommutative(int op)
+{ return op == PLUS || op == TIMES || op == EQ || op == NE;
+}
+
+/* numberBlock numbers the values of block p and
+ * returns the number of operations removed
+ */
+static int numberBlock(IrBlock * p)
+{ int k, n = 0, v, removed = 0;
+  for (v=0;v<nValues;v++)
+    table[values[v].slot] = -1;
+  nValues = 0;
+  memVersion = callVersion = 0;
+  for (k=0;k<p->nCode;k++)
+  { IrInstr * i = &p->code[k];
+    IrOp op = i->op;
+    int val = i->val, b;
+    if (i->a >= 0) i->a = same[i->a];
+    if (i->b >= 0) i->b = same[i->b];
+    b = i->b;
+    switch (op)
+    { case IrBin:
+        if (isCommutative(i->val) && i->a > i->b)
+        { int t = i->a;
+          i->a = i->b;
+          i->b = t;
+        }
+        b = i->b;
+        /* fall through */
+      case IrConst:
+      case IrAddr:
+      case IrLoad:
+      case IrLoadI:
+        if (op == IrLoad)
+        { val = stores(i->sym);
+          b = calls(i->sym);
+        }
+        else if (op == IrLoadI)
+          b = memVersion;
+        v = find(op,val,i->sym,i->a,b);
+        if (v >= 0)
+        { same[i->dst] = values[v].t;
+          /* constants and addresses are computed
+           * again where they are read anyway
+           */
+          if (op != IrConst && op != IrAddr)
+            removed++;
+          continue;
+        }
+        enter(op,val,i->sym,i->a,b,i->dst);
+        break;
+      case IrStore:
+        val = stores(i->sym) + 1;
+        enter(IrStore,0,i->sym,-1,-1,val);
+        enter(IrLoad,val,i->sym,-1,calls(i->sym),i->a);
+        break;
+      case IrStoreI:
+        memVersion++;
+        enter(IrLoadI,0,NULL,i->a,memVersion,i->b);
+        break;
+      case IrCall:
+        memVersion++;
+        callVersion++;
+        break;
+      default:
+        break;
+    }
+    p->code[n++] = *i;
+  }
+  p->nCode = n;
+  return removed;
+}
+
+int valueNumber(IrFunc * f)
+{ int b, k, t, removed = 0;
+  same = (int *) tagAlloc(CodeGenMem,(f->nTemps+1) * sizeof(int));
+  for (t=0;t<f->nTemps;t++)
+    same[t] = t;
+  nValues = 0;
+  growTable();
+  for (b=0;b<f->nBlocks;b++)
+    removed += numberBlock(&f->blocks[b]);
+  /* reads in other blocks */
+  for (b=0;b<f->nBlocks;b++)
+    for (k=0;k<f->blocks[b].nCode;k++)
+    { IrInstr * i = &f->blocks[b].code[k];
+      if (i->a >= 0) i->a = same[i->a];
+      if (i->b >= 0) i->b = same[i->b];
+    }
+  free(same);
+  free(values);
+  free(table);
+  values = NULL;
+  table = NULL;
+  valuesSize = tableSize = 0;
+  countEvent("lvn ops",removed);
+  return removed;
+}
@@ -0,0 +1,21 @@
+/****************************************************/
+/* File: lvn.h                                      */
+/* Local value numbering interface for the C-minus  */
+/* compiler                                         */
+/****************************************************/
+
+#ifndef _LVN_H_
+#define _LVN_H_
+
+/* Function valueNumber removes from each block of f
+ * the instructions that compute again a value the
+ * block already has: the same operator on the same
+ * operands, the same array element or address, or a
+ * variable loaded or stored and not changed since.
+ * Reads of a removed temp read the earlier one. It
+ * returns the number of operations removed, which
+ * is also counted (see countEvent)
+ */
+int valueNumber(IrFunc * f);
+
+#endif
@@ -6,6 +6,9 @@
 /****************************************************/
 
 #include "globals.h"
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
 
 /* set NO_PARSE to TRUE to get a scanner-only compiler */
 #define NO_PARSE FALSE 
@@ -15,21 +18,33 @@
 /* set NO_CODE to TRUE to get a compiler that does not
  * generate code
  */
-#define NO_CODE TRUE
+#define NO_CODE FALSE
 
 #include "util.h"
+#include "stats.h"
 #if NO_PARSE
 #include "scan.h"
 #else
 #include "parse.h"
+#include "astcache.h"
+#include "pushscan.h"
 #if !NO_ANALYZE
 #include "analyze.h"
+#include "symtab.h"
+#include "diag.h"
 #if !NO_CODE
+#include "callgraph.h"
+#include "simplify.h"
 #include "cgen.h"
 #endif
 #endif
 #endif
 
+/* STDIN_CODE is the code file of a program read
+ * from standard input ("-"), whose name gives none
+ */
+#define STDIN_CODE "a.tm"
+
 /* allocate global variables */
 int lineno = 0;
 FILE * source;
@@ -42,64 +57,310 @@ int TraceScan = FALSE;
 int TraceParse = FALSE;
 int TraceAnalyze = TRUE;
 int TraceCode = FALSE;
+int TraceIR = FALSE;
+
+/* allocate and set front end options */
+int AstCache = FALSE;
+int PushParse = FALSE;
+int LazyBodies = FALSE;
+int DeclsOnly = FALSE;
+int FusedAnalysis = FALSE;
+int Jobs = 0;
+int Watch = FALSE;
+int TimeReport = FALSE;
+int MemReport = FALSE;
+int ErrorLimit = 100;
+int Optimize = TRUE;
 
 int Error = FALSE;
 
+static void usage(char * prog)
+{ fprintf(stderr,"usage: %s [-cache] [-push] [-lazy] [-decls] [-fused] [-j[N]] [-watch] [-time[=json]] [-mem] [-errors=N] [-ir] [-O0] <filename | ->\n",prog);
+  exit(1);
+}
+
+#if !NO_PARSE && !NO_ANALYZE
+/* WATCH_INTERVAL is the time in microseconds
+ * between two looks at the source file
+ */
+#define WATCH_INTERVAL 100000
+
+static int sameTime(struct timespec a, struct timespec b)
+{ return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+static double msSince(struct timespec t0)
+{ struct timespec t1;
+  clock_gettime(CLOCK_MONOTONIC,&t1);
+  return (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+}
+
+/* readSource returns the text of file pgm and puts
+ * its length in len, or returns NULL
+ */
+static char * readSource(char * pgm, long * len)
+{ FILE * f = fopen(pgm,"r");
+  char * text;
+  if (f == NULL)
+    return NULL;
+  fseek(f,0L,SEEK_END);
+  *len = ftell(f);
+  rewind(f);
+  text = (char *) tagAlloc(OtherMem,*len + 1);
+  if (fread(text,1,*len,f) != (size_t) *len)
+  { free(text);
+    text = NULL;
+  }
+  fclose(f);
+  return text;
+}
+
+/* Procedure watch checks file pgm, and checks it
+ * again each time it is modified, until it is
+ * removed. Only the functions that changed, or
+ * that use a global declaration that changed, are
+ * checked again
+ */
+static void watch(char * pgm)
+{ struct stat st;
+  struct timespec mtime, t0;
+  TreeNode * syntaxTree, * t;
+  char * text;
+  long len;
+  int rechecked, nFuncs, first = TRUE;
+  double ms;
+  for (;;)
+  { if (!first)
+      usleep(WATCH_INTERVAL);
+    if (stat(pgm,&st) != 0)
+      break;
+    if (!first && sameTime(st.st_mtim,mtime))
+      continue;
+    mtime = st.st_mtim;
+    text = readSource(pgm,&len);
+    if (text == NULL)
+      continue;
+    if (!first)
+      fprintf(listing,"\nCMINUS COMPILATION: %s\n",pgm);
+    first = FALSE;
+    Error = FALSE;
+    diagReset();
+    pushScanBegin();
+    pushScanChunk(text,(int) len);
+    syntaxTree = pushScanEnd();
+    if (Error)
+    { freeTree(syntaxTree);
+      free(text);
+      fflush(listing);
+      continue;
+    }
+    fprintf(listing,"\nBuilding Symbol Table...\n\n");
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    syntaxTree = incrementalAnalyze(syntaxTree,text,Jobs,&rechecked);
+    ms = msSince(t0);
+    if (TraceAnalyze && !Error)
+    { fprintf(listing,"\nSymbol table:\n\n");
+      printSymTab(listing);
+    }
+    if (!Error)
+    { fprintf(listing,"\nChecking Types...\n\n");
+      typeCheckReport();
+      fprintf(listing,"\nType Checking Finished\n");
+    }
+    nFuncs = 0;
+    for (t=syntaxTree;t!=NULL;t=t->sibling)
+      if (t->kind.stmt == FuncK)
+        nFuncs++;
+    fprintf(listing,"\nRe-checked %d of %d functions in %.3f ms\n",
+            rechecked,nFuncs,ms);
+    fflush(listing);
+    freeDropped();
+  }
+}
+#endif
+
 int main( int argc, char * argv[] )
 { TreeNode * syntaxTree;
   char pgm[120]; /* source code file name */
-  if (argc != 2)
-    { fprintf(stderr,"usage: %s <filename>\n",argv[0]);
-      exit(1);
+  int i;
+  for (i=1;i<argc && argv[i][0]=='-' && argv[i][1]!='\0';i++)
+  { if (strcmp(argv[i],"-cache") == 0)
+      AstCache = TRUE;
+    else if (strcmp(argv[i],"-push") == 0)
+      PushParse = TRUE;
+    else if (strcmp(argv[i],"-lazy") == 0)
+      LazyBodies = TRUE;
+    else if (strcmp(argv[i],"-decls") == 0)
+      DeclsOnly = TRUE;
+    else if (strcmp(argv[i],"-fused") == 0)
+      FusedAnalysis = TRUE;
+    else if (strcmp(argv[i],"-watch") == 0)
+      Watch = TRUE;
+    else if (strcmp(argv[i],"-time") == 0)
+      TimeReport = TIME_TABLE;
+    else if (strcmp(argv[i],"-time=json") == 0)
+      TimeReport = TIME_JSON;
+    else if (strcmp(argv[i],"-mem") == 0)
+      MemReport = TRUE;
+    else if (strcmp(argv[i],"-ir") == 0)
+      TraceIR = TRUE;
+    else if (strcmp(argv[i],"-O0") == 0)
+      Optimize = FALSE;
+    else if (strncmp(argv[i],"-errors=",8) == 0 && isdigit(argv[i][8]))
+      ErrorLimit = atoi(argv[i]+8);
+    else if (strncmp(argv[i],"-j",2) == 0)
+    { Jobs = atoi(argv[i]+2);
+      if (Jobs <= 0)
+        Jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
     }
-  strcpy(pgm,argv[1]) ;
-  if (strchr (pgm, '.') == NULL)
-     strcat(pgm,".tny");
-  source = fopen(pgm,"r");
+    else
+      usage(argv[0]);
+  }
+  if (i != argc-1)
+    usage(argv[0]);
+  if (MemReport)
+    atexit(printMemStats);
+  strcpy(pgm,argv[i]) ;
+  if (Watch && strcmp(pgm,"-") == 0)
+    usage(argv[0]);
+  if (strcmp(pgm,"-") == 0)
+    source = stdin;
+  else
+  { if (strchr (pgm, '.') == NULL)
+      strcat(pgm,".tny");
+    source = fopen(pgm,"r");
+  }
   if (source==NULL)
   { fprintf(stderr,"File %s not found\n",pgm);
     exit(1);
   }
+  /* bodies are reread from the source when they
+   * are needed, which takes a seekable file; cached
+   * trees must be complete
+   */
+  if (DeclsOnly)
+    LazyBodies = TRUE;
+  if (AstCache || (!DeclsOnly && fseek(source,0L,SEEK_CUR) != 0))
+    LazyBodies = FALSE;
   listing = stdout; /* send listing to screen */
   fprintf(listing,"\nCMINUS COMPILATION: %s\n",pgm);
 #if NO_PARSE
   while (getToken()!=ENDFILE);
 #else
-  syntaxTree = parse();
+#if !NO_ANALYZE
+  /* watching keeps the analysis of each function,
+   * which takes complete trees and the parallel
+   * analysis
+   */
+  if (Watch)
+  { fclose(source);
+    if (Jobs == 0)
+      Jobs = 1;
+    LazyBodies = FALSE;
+    watch(pgm);
+    return 0;
+  }
+#endif
+  phaseBegin(ParsePhase);
+  if (AstCache)
+    syntaxTree = cachedParse();
+  else if (PushParse)
+    syntaxTree = streamParse(fileno(source));
+  else
+    syntaxTree = parse();
+  phaseEnd(ParsePhase);
   if (TraceParse) {
     fprintf(listing,"\nSyntax tree:\n");
     printTree(syntaxTree);
   }
 #if !NO_ANALYZE
-  if (!Error && TraceAnalyze)
+  if (!Error && TraceAnalyze && DeclsOnly)
+  { fprintf(listing,"\nBuilding Global Symbol Table...\n\n");
+    phaseBegin(SymtabPhase);
+    buildGlobalSymtab(syntaxTree);
+    phaseEnd(SymtabPhase);
+    if (TimeReport) printStats();
+    fclose(source);
+    return 0;
+  }
+
+  if (!Error && TraceAnalyze && (FusedAnalysis || Jobs > 0))
   { fprintf(listing,"\nBuilding Symbol Table...\n\n");
-    buildSymtab(syntaxTree);
+    /* the symbol table phase also checks types;
+     * the type check phase only reports the errors
+     */
+    phaseBegin(SymtabPhase);
+    if (Jobs > 0)
+      parallelAnalyze(syntaxTree,Jobs);
+    else
+      fusedAnalyze(syntaxTree);
+    phaseEnd(SymtabPhase);
+    if (!Error)
+    { fprintf(listing,"\nChecking Types...\n\n");
+      phaseBegin(TypeCheckPhase);
+      typeCheckReport();
+      phaseEnd(TypeCheckPhase);
+      fprintf(listing,"\nType Checking Finished\n");
+    }
   }
+  else
+  { if (!Error && TraceAnalyze)
+    { fprintf(listing,"\nBuilding Symbol Table...\n\n");
+      phaseBegin(SymtabPhase);
+      buildSymtab(syntaxTree);
+      phaseEnd(SymtabPhase);
+    }
 
-  if (!Error && TraceAnalyze)
-  { fprintf(listing,"\nChecking Types...\n\n");
-    typeCheck(syntaxTree);
-    fprintf(listing,"\nType Checking Finished\n");
+    if (!Error && TraceAnalyze)
+    { fprintf(listing,"\nChecking Types...\n\n");
+      phaseBegin(TypeCheckPhase);
+      typeCheck(syntaxTree);
+      phaseEnd(TypeCheckPhase);
+      fprintf(listing,"\nType Checking Finished\n");
+    }
   }
 
 #if !NO_CODE
   if (! Error)
   { char * codefile;
     int fnlen = strcspn(pgm,".");
-    codefile = (char *) calloc(fnlen+4, sizeof(char));
-    strncpy(codefile,pgm,fnlen);
-    strcat(codefile,".tm");
+    int dropped;
+    /* functions main never calls get no code */
+    buildCallGraph(syntaxTree);
+    syntaxTree = dropUnreachable(syntaxTree,&dropped);
+    if (TraceCode && dropped > 0)
+      fprintf(listing,"\nDropped %d unreachable functions\n",dropped);
+    if (Optimize)
+    { int removed;
+      phaseBegin(OptimizePhase);
+      removed = simplifyTree(syntaxTree);
+      phaseEnd(OptimizePhase);
+      if (TraceCode && removed > 0)
+        fprintf(listing,"\nSimplified away %d nodes\n",removed);
+    }
+    if (strcmp(pgm,"-") == 0)
+    { codefile = (char *) tagAlloc(OtherMem,sizeof(STDIN_CODE));
+      strcpy(codefile,STDIN_CODE);
+    }
+    else
+    { codefile = (char *) tagCalloc(OtherMem,fnlen+4, sizeof(char));
+      strncpy(codefile,pgm,fnlen);
+      strcat(codefile,".tm");
+    }
     code = fopen(codefile,"w");
     if (code == NULL)
     { printf("Unable to open %s\n",codefile);
       exit(1);
     }
+    phaseBegin(CodeGenPhase);
     codeGen(syntaxTree,codefile);
+    phaseEnd(CodeGenPhase);
     fclose(code);
   }
 #endif
 #endif
 #endif
+  if (TimeReport) printStats();
   fclose(source);
   return 0;
 }
@@ -13,4 +13,29 @@
  */
 TreeNode * parse(void);
 
+/* Procedure pushParseBegin starts a push parse */
+void pushParseBegin(void);
+
+/* Function pushToken feeds one token, whose lexeme
+ * is in tokenString, to the push parser. It returns
+ * TRUE while the parser expects more tokens
+ */
+int pushToken(TokenType token);
+
+/* Function pushParseEnd returns the syntax tree
+ * built by the push parse
+ */
+TreeNode * pushParseEnd(void);
+
+/* Procedure parseLazyBody parses the body of function
+ * t, skipped by a lazy parse, from its source span
+ */
+void parseLazyBody(TreeNode * t);
+
+/* Function declSpans returns the source spans of
+ * the top-level declarations of the last parse, in
+ * order, and puts their number in n
+ */
+SourceSpan * declSpans(int * n);
+
 #endif
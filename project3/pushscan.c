@@ -0,0 +1,236 @@
+/****************************************************/
+/* File: pushscan.c                                 */
+/* Incremental scanner implementation for the       */
+/* C-minus compiler                                 */
+/* The DFA follows the rules of cminus.l; its state */
+/* survives chunk boundaries, so a token may be     */
+/* split across any number of reads                 */
+/****************************************************/
+
+#include <unistd.h>
+#include <errno.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "pushscan.h"
+#include "stats.h"
+
+/* states in scanner DFA */
+typedef enum
+   { START,INNUM,INID,INEQ,INLT,INGT,INNE,INOVER,INCOMMENT,INCOMMENT_ }
+   StateType;
+
+static StateType state = START;
+
+/* lexeme of the token being scanned */
+static char lexeme[MAXTOKENLEN+1];
+static int lexemeLen = 0;
+
+/* source offsets of the next character and of
+ * the first character of the lexeme
+ */
+static long scanPos = 0;
+static long lexemeStart = 0;
+
+/* FALSE once the parser accepted or rejected the input */
+static int parsing = FALSE;
+
+/* lookup table of reserved words */
+static struct
+    { char* str;
+      TokenType tok;
+    } reservedWords[]
+   = {{"if",IF},{"else",ELSE},{"while",WHILE},{"return",RETURN},
+      {"int",INT},{"void",VOID},{"then",THEN},{"end",END},
+      {"repeat",REPEAT},{"until",UNTIL},{"read",READ},{"write",WRITE}};
+
+/* lookup an identifier to see if it is a reserved word */
+static TokenType reservedLookup (char * s)
+{ int i;
+  for (i=0;i<(int)(sizeof(reservedWords)/sizeof(reservedWords[0]));i++)
+    if (!strcmp(s,reservedWords[i].str))
+      return reservedWords[i].tok;
+  return ID;
+}
+
+static void saveChar(int c)
+{ if (lexemeLen < MAXTOKENLEN)
+    lexeme[lexemeLen++] = (char) c;
+}
+
+/* emit hands the completed token to the parser */
+static void emit(TokenType token)
+{ lexeme[lexemeLen] = '\0';
+  if (token == ID)
+    token = reservedLookup(lexeme);
+  strcpy(tokenString,lexeme);
+  tokenPos = lexemeStart;
+  tokenCount++;
+  lexemeLen = 0;
+  state = START;
+  if (TraceScan) {
+    fprintf(listing,"\t%d: ",lineno);
+    printToken(token,tokenString);
+  }
+  if (parsing)
+    parsing = pushToken(token);
+}
+
+/* scanChar advances the DFA by one character */
+static void scanChar(int c)
+{ switch (state)
+  { case INNUM:
+      if (isdigit(c)) { saveChar(c); return; }
+      emit(NUM);
+      break;
+    case INID:
+      if (isalpha(c)) { saveChar(c); return; }
+      emit(ID);
+      break;
+    case INEQ:
+      if (c == '=') { saveChar(c); emit(EQ); return; }
+      emit(ASSIGN);
+      break;
+    case INLT:
+      if (c == '=') { saveChar(c); emit(LE); return; }
+      emit(LT);
+      break;
+    case INGT:
+      if (c == '=') { saveChar(c); emit(GE); return; }
+      emit(GT);
+      break;
+    case INNE:
+      if (c == '=') { saveChar(c); emit(NE); return; }
+      emit(ERROR);
+      break;
+    case INOVER:
+      if (c == '*')
+      { lexemeLen = 0;
+        state = INCOMMENT;
+        return;
+      }
+      emit(OVER);
+      break;
+    case INCOMMENT:
+      if (c == '\n') lineno++;
+      if (c == '*') state = INCOMMENT_;
+      return;
+    case INCOMMENT_:
+      if (c == '\n') lineno++;
+      if (c == '/') state = START;
+      else if (c != '*') state = INCOMMENT;
+      return;
+    default:
+      break;
+  }
+
+  /* state is START: c begins a new token */
+  lexemeStart = scanPos;
+  if (isdigit(c)) { saveChar(c); state = INNUM; }
+  else if (isalpha(c)) { saveChar(c); state = INID; }
+  else if (c == '\n') lineno++;
+  else if (c == ' ' || c == '\t') ;
+  else
+  { saveChar(c);
+    switch (c)
+    { case '=': state = INEQ; break;
+      case '<': state = INLT; break;
+      case '>': state = INGT; break;
+      case '!': state = INNE; break;
+      case '/': state = INOVER; break;
+      case '+': emit(PLUS); break;
+      case '-': emit(MINUS); break;
+      case '*': emit(TIMES); break;
+      case '(': emit(LPAREN); break;
+      case ')': emit(RPAREN); break;
+      case '[': emit(LBRACE); break;
+      case ']': emit(RBRACE); break;
+      case '{': emit(LCURLY); break;
+      case '}': emit(RCURLY); break;
+      case ';': emit(SEMI); break;
+      case ',': emit(COMMA); break;
+      default: emit(ERROR); break;
+    }
+  }
+}
+
+/* Procedure pushScanBegin starts scanning a new
+ * source text (and a new push parse)
+ */
+void pushScanBegin(void)
+{ state = START;
+  lexemeLen = 0;
+  scanPos = 0;
+  lineno = 1;
+  parsing = TRUE;
+  pushParseBegin();
+}
+
+/* Function pushScanChunk scans the len characters
+ * in buf. It returns TRUE while the parser expects
+ * more input
+ */
+int pushScanChunk(const char * buf, int len)
+{ int i;
+  for (i=0;i<len && parsing;i++)
+  { scanChar((unsigned char) buf[i]);
+    scanPos++;
+  }
+  return parsing;
+}
+
+/* Function pushScanEnd marks the end of the source
+ * text and returns the syntax tree
+ */
+TreeNode * pushScanEnd(void)
+{ switch (state)
+  { case INNUM: emit(NUM); break;
+    case INID: emit(ID); break;
+    case INEQ: emit(ASSIGN); break;
+    case INLT: emit(LT); break;
+    case INGT: emit(GT); break;
+    case INNE: emit(ERROR); break;
+    case INOVER: emit(OVER); break;
+    default: break;
+  }
+  lexemeLen = 0;
+  lexemeStart = scanPos;
+  emit(ENDFILE);
+  parsing = FALSE;
+  return pushParseEnd();
+}
+
+/* Function pushScanBody parses the len characters
+ * in buf, which start at source offset pos and line
+ * line, as a single function body and returns its
+ * compound statement
+ */
+TreeNode * pushScanBody(const char * buf, int len, long pos, int line)
+{ pushScanBegin();
+  scanPos = pos;
+  lineno = line;
+  parsing = pushToken(FUNCBODY);
+  pushScanChunk(buf,len);
+  return pushScanEnd();
+}
+
+/* Function streamParse parses the source read from
+ * file descriptor fd (a file, pipe or socket),
+ * scanning and parsing each chunk as it arrives
+ */
+TreeNode * streamParse(int fd)
+{ char buf[CHUNKSIZE];
+  int n;
+  pushScanBegin();
+  for (;;)
+  { n = read(fd,buf,CHUNKSIZE);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    if (!pushScanChunk(buf,n))
+      break;
+  }
+  return pushScanEnd();
+}
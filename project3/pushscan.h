@@ -0,0 +1,44 @@
+/****************************************************/
+/* File: pushscan.h                                 */
+/* Incremental scanner interface for the C-minus    */
+/* compiler: source text is pushed in chunks of any */
+/* size and tokens are fed to the push parser as    */
+/* soon as they are complete                        */
+/****************************************************/
+
+#ifndef _PUSHSCAN_H_
+#define _PUSHSCAN_H_
+
+/* CHUNKSIZE is the largest read done by streamParse */
+#define CHUNKSIZE 4096
+
+/* Procedure pushScanBegin starts scanning a new
+ * source text (and a new push parse)
+ */
+void pushScanBegin(void);
+
+/* Function pushScanChunk scans the len characters
+ * in buf. It returns TRUE while the parser expects
+ * more input
+ */
+int pushScanChunk(const char * buf, int len);
+
+/* Function pushScanEnd marks the end of the source
+ * text and returns the syntax tree
+ */
+TreeNode * pushScanEnd(void);
+
+/* Function pushScanBody parses the len characters
+ * in buf, which start at source offset pos and line
+ * line, as a single function body and returns its
+ * compound statement
+ */
+TreeNode * pushScanBody(const char * buf, int len, long pos, int line);
+
+/* Function streamParse parses the source read from
+ * file descriptor fd (a file, pipe or socket),
+ * scanning and parsing each chunk as it arrives
+ */
+TreeNode * streamParse(int fd);
+
+#endif
@@ -14,6 +14,9 @@
 /* tokenString array stores the lexeme of each token */
 extern char tokenString[MAXTOKENLEN+1];
 
+/* tokenPos is the source offset of that lexeme */
+extern long tokenPos;
+
 /* function getToken returns the 
  * next token in source file
  */
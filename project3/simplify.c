@@ -0,0 +1,136 @@
+/****************************************************/
+/* File: simplify.c                                 */
+/* Syntax tree simplification implementation for    */
+/* the C-minus compiler                             */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "util.h"
+#include "simplify.h"
+#include "stats.h"
+
+/* nodes eliminated so far */
+static int removed;
+
+/* the size of a subtree, and whether it calls,
+ * assigns or divides by what may be 0 or -1 (see
+ * foldOp), found by countNode
+ */
+static int subtreeSize, subtreeImpure;
+
+static void countNode(TreeNode * t)
+{ subtreeSize++;
+  if (nodeType(t) == CallT || nodeType(t) == AssignT)
+    subtreeImpure = TRUE;
+  else if (nodeType(t) == OpT && t->attr.op == OVER &&
+           !(nodeType(t->child[1]) == ConstT &&
+             t->child[1]->attr.val != 0 && t->child[1]->attr.val != -1))
+    subtreeImpure = TRUE;
+}
+
+static const NodeProc countVisitor[NODETYPES] = EVERYNODE(countNode);
+
+/* isConst tells whether node t is the constant v */
+static int isConst(TreeNode * t, int v)
+{ return nodeType(t) == ConstT && t->attr.val == v;
+}
+
+/* foldOp computes a op b into *v as the TM does:
+ * sums and products wrap around, and comparisons
+ * test the sign of the wrapped difference. It
+ * returns FALSE for a division the TM would stop
+ * at or that overflows
+ */
+static int foldOp(TokenType op, int a, int b, int * v)
+{ int d = (int) ((unsigned) a - (unsigned) b);
+  switch (op)
+  { case PLUS: *v = (int) ((unsigned) a + (unsigned) b); break;
+    case MINUS: *v = d; break;
+    case TIMES: *v = (int) ((unsigned) a * (unsigned) b); break;
+    case OVER:
+      if (b == 0 || (a == INT_MIN && b == -1))
+        return FALSE;
+      *v = a / b;
+      break;
+    case LT: *v = d < 0; break;
+    case LE: *v = d <= 0; break;
+    case GT: *v = d > 0; break;
+    case GE: *v = d >= 0; break;
+    case EQ: *v = d == 0; break;
+    case NE: *v = d != 0; break;
+    default: return FALSE;
+  }
+  return TRUE;
+}
+
+/* makeConst turns node t into the constant v */
+static void makeConst(TreeNode * t, int v)
+{ int i;
+  for (i=0;i<MAXCHILDREN;i++)
+    t->child[i] = NULL;
+  t->kind.exp = ConstK;
+  t->attr.val = v;
+}
+
+/* replaceBy puts operand c in the place of its
+ * operation t
+ */
+static void replaceBy(TreeNode * t, TreeNode * c)
+{ TreeNode * sibling = t->sibling;
+  int is_argu = t->is_argu;
+  *t = *c;
+  t->sibling = sibling;
+  t->is_argu = is_argu;
+}
+
+/* simplifyOp simplifies operation t, whose
+ * operands are already simplified
+ */
+static void simplifyOp(TreeNode * t)
+{ TreeNode * a = t->child[0], * b = t->child[1];
+  int v;
+  if (nodeType(a) == ConstT && nodeType(b) == ConstT &&
+      foldOp(t->attr.op,a->attr.val,b->attr.val,&v))
+  { makeConst(t,v);
+    removed += 2;
+    return;
+  }
+  switch (t->attr.op)
+  { case PLUS:
+      if (isConst(a,0)) { replaceBy(t,b); removed += 2; return; }
+      if (isConst(b,0)) { replaceBy(t,a); removed += 2; return; }
+      break;
+    case MINUS:
+      if (isConst(b,0)) { replaceBy(t,a); removed += 2; return; }
+      break;
+    case TIMES:
+      if (isConst(a,1)) { replaceBy(t,b); removed += 2; return; }
+      if (isConst(b,1)) { replaceBy(t,a); removed += 2; return; }
+      if (isConst(a,0) || isConst(b,0))
+      { TreeNode * x = isConst(a,0) ? b : a;
+        subtreeSize = 0;
+        subtreeImpure = FALSE;
+        traverseTree(x,countVisitor,NULL);
+        if (!subtreeImpure)
+        { makeConst(t,0);
+          removed += subtreeSize + 1;
+        }
+      }
+      break;
+    case OVER:
+      if (isConst(b,1)) { replaceBy(t,a); removed += 2; return; }
+      break;
+    default:
+      break;
+  }
+}
+
+static const NodeProc simplifyVisitor[NODETYPES] = { [OpT] = simplifyOp };
+
+int simplifyTree(TreeNode * syntaxTree)
+{ removed = 0;
+  traverseTree(syntaxTree,NULL,simplifyVisitor);
+  countEvent("fold nodes",removed);
+  return removed;
+}
@@ -0,0 +1,19 @@
+/****************************************************/
+/* File: simplify.h                                 */
+/* Syntax tree simplification interface for the     */
+/* C-minus compiler                                 */
+/****************************************************/
+
+#ifndef _SIMPLIFY_H_
+#define _SIMPLIFY_H_
+
+/* Function simplifyTree folds the operations on
+ * constants of syntaxTree, which was analyzed
+ * without errors, as TM computes them, and applies
+ * the identities x+0 = x-0 = x*1 = x/1 = x and
+ * x*0 = 0 (if x has no side effects). It returns
+ * the number of nodes eliminated
+ */
+int simplifyTree(TreeNode * syntaxTree);
+
+#endif
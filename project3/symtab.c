@@ -11,8 +11,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "symtab.h"
 #include "globals.h"
+#include "stats.h"
 
 /* SHIFT is the power of two used as multiplier
    in hash function  */
@@ -29,44 +31,141 @@ static int hash ( char * key )
   return temp;
 }
 
-/* the hash table */
-static ScopeList scopeTable[SIZE];
-static ScopeList scopeStack[SIZE];
-static int varLocation[SIZE];
+/* the table of all scopes and the stack of open
+ * scopes; both grow on demand so that programs with
+ * many functions or deeply nested blocks fit.
+ * The stack is per thread: parallel analysis gives
+ * each function its own
+ */
+static ScopeList * scopeTable = NULL;
+static __thread ScopeList * scopeStack = NULL;
+static __thread int * varLocation = NULL;
 static int nScope = 0;
-static int nScopeTop = 0;
-static int nestedLv= 0;
+static __thread int nScopeTop = 0;
+static __thread int nestedLv= 0;
+static int scopeTableSize = 0;
+static __thread int scopeStackSize = 0;
+
+/* number of symbols declared in the global scope */
+static int nGlobals = 0;
+
+/* the unit being analyzed by this thread, if any,
+ * and the number of global symbols visible to it
+ */
+static __thread SymUnit curUnit = NULL;
+static __thread int visibleGlobals = INT_MAX;
+
+/* makes room for one more open scope on the stack */
+static void grow_scopes(void)
+{ if (nScopeTop == scopeStackSize)
+  { scopeStackSize = scopeStackSize ? scopeStackSize * 2 : SIZE;
+    scopeStack = (ScopeList *) tagRealloc(SymtabMem,scopeStack,scopeStackSize * sizeof(ScopeList));
+    varLocation = (int *) tagRealloc(SymtabMem,varLocation,scopeStackSize * sizeof(int));
+  }
+}
+
+/* adds a new scope to the table, or to the scopes
+ * of the current unit
+ */
+static void add_scope(ScopeList scope)
+{ ScopeList ** table = &scopeTable;
+  int * n = &nScope, * size = &scopeTableSize;
+  if (curUnit != NULL)
+  { table = &curUnit->scopes;
+    n = &curUnit->nScopes;
+    size = &curUnit->scopesSize;
+  }
+  if (*n == *size)
+  { *size = *size ? *size * 2 : SIZE;
+    *table = (ScopeList *) tagRealloc(SymtabMem,*table,*size * sizeof(ScopeList));
+  }
+  (*table)[(*n)++] = scope;
+}
+
+/* adds local symbol l to the symbols of unit */
+static void add_local(SymUnit unit, BucketList l)
+{ if (unit->nLocals == unit->localsSize)
+  { unit->localsSize = unit->localsSize ? unit->localsSize * 2 : 16;
+    unit->locals = (BucketList *) tagRealloc(SymtabMem,unit->locals,unit->localsSize * sizeof(BucketList));
+  }
+  l->local_order = unit->nLocals;
+  unit->locals[unit->nLocals++] = l;
+}
+
+/* adds a reference to global symbol bucket at line
+ * lineno to the references of unit
+ */
+static void add_ref(SymUnit unit, BucketList bucket, int lineno)
+{ if (unit->nRefs == unit->refsSize)
+  { unit->refsSize = unit->refsSize ? unit->refsSize * 2 : SIZE;
+    unit->refBuckets = (BucketList *) tagRealloc(SymtabMem,unit->refBuckets,unit->refsSize * sizeof(BucketList));
+    unit->refLines = (int *) tagRealloc(SymtabMem,unit->refLines,unit->refsSize * sizeof(int));
+  }
+  unit->refBuckets[unit->nRefs] = bucket;
+  unit->refLines[unit->nRefs] = lineno;
+  unit->nRefs++;
+}
 
 extern ScopeList globalScope;
 
-int get_location()
-{ return varLocation[nScopeTop - 1]++;
+/* Function get_location reserves size words for a
+ * variable of the current scope. A global is found
+ * at gp plus its location, and its words ascend
+ * from there. The locals of a function are counted
+ * from the top of its frame, which grows downward
+ * (see cgen.c), so the location of a local array
+ * is that of its last word, the lowest address
+ */
+int get_location(int size)
+{ int loc = varLocation[nScopeTop - 1];
+  varLocation[nScopeTop - 1] += size;
+  if (nScopeTop > 1 && size > 0)
+    loc += size - 1;
+  return loc;
 }
 
 ScopeList get_cur_scope()
-{ return scopeStack[nScopeTop - 1];
+{ if (nScopeTop == 0)
+    return NULL;
+  return scopeStack[nScopeTop - 1];
 }
 
 void insert_scope( char * name )
 { ScopeList parent = get_cur_scope();
-  scopeStack[nScopeTop] = (ScopeList) malloc(sizeof(struct ScopeListRec));
+  grow_scopes();
+  /* a block inside a function takes the words
+   * after those of the blocks around it
+   */
+  varLocation[nScopeTop] = nestedLv >= 2 ? varLocation[nScopeTop - 1] : 0;
+  scopeStack[nScopeTop] = (ScopeList) tagCalloc(SymtabMem,1,sizeof(struct ScopeListRec));
   scopeStack[nScopeTop]->name = name;
   scopeStack[nScopeTop]->parent = parent;
   scopeStack[nScopeTop]->param_size = 0;
 
   scopeStack[nScopeTop]->nested_level = nestedLv;
   if (nestedLv == 1)
-    scopeStack[nScopeTop]->param_list = (int *) malloc(sizeof(int) * SIZE);
+    scopeStack[nScopeTop]->param_list = (int *) tagAlloc(SymtabMem,sizeof(int) * SIZE);
 
-  scopeTable[nScope] = scopeStack[nScopeTop];
+  add_scope(scopeStack[nScopeTop]);
+
+  /* a function scope is found through the
+   * function's global symbol
+   */
+  if (nestedLv == 1)
+  { BucketList l = globalScope->bucket[hash(name)];
+    while ((l != NULL) && (strcmp(name,l->name) != 0))
+      l = l->next;
+    if (l != NULL && l->func_scope == NULL)
+      l->func_scope = scopeStack[nScopeTop];
+  }
 
   nestedLv++;
   nScopeTop++;
-  nScope++;
 }
 
 void push_scope( ScopeList scope )
-{ scopeStack[nScopeTop] = scope;
+{ grow_scopes();
+  scopeStack[nScopeTop] = scope;
   varLocation[nScopeTop] = 0;
   nScopeTop++;
 }
@@ -77,19 +176,19 @@ void del_cur_scope()
 }
 
 ScopeList find_func_def_scope(char * name)
-{ int i;
-  for (i=0;i<nScope;i++)
-  { if (scopeTable[i]->nested_level == 1 && strcmp(scopeTable[i]->name, name) == 0)
-      return scopeTable[i];
-  }
+{ BucketList l = globalScope->bucket[hash(name)];
+  while ((l != NULL) && (strcmp(name,l->name) != 0))
+    l = l->next;
+  return l == NULL ? NULL : l->func_scope;
 }
 
-/* Procedure st_insert inserts line numbers and
- * memory locations into the symbol table
+/* Function st_insert inserts line numbers and
+ * memory locations into the symbol table and
+ * returns the symbol
  * loc = memory location is inserted only the
  * first time, otherwise ignored
  */
-void st_insert( char * name, ExpType type, int lineno, int loc, NodeKind nodekind, StmtKind stmt, ExpKind exp )
+BucketList st_insert( char * name, ExpType type, int lineno, int loc, NodeKind nodekind, StmtKind stmt, ExpKind exp )
 { ScopeList sl = get_cur_scope();
   int bh;
   BucketList l = NULL;
@@ -100,12 +199,13 @@ void st_insert( char * name, ExpType type, int lineno, int loc, NodeKind nodekin
   while ((l != NULL) && (strcmp(name,l->name) != 0))
     l = l->next;
   if (l == NULL) /* variable not yet in table */
-  { l = (BucketList) malloc(sizeof(struct BucketListRec));
+  { l = (BucketList) tagAlloc(SymtabMem,sizeof(struct BucketListRec));
     l->name = name;
 	l->type = type;
-    l->lines = (LineList) malloc(sizeof(struct LineListRec));
+    l->lines = (LineList) tagAlloc(SymtabMem,sizeof(struct LineListRec));
     l->lines->lineno = lineno;
     l->memloc = loc;
+	l->nodekind = nodekind;
 
     if (nodekind == StmtK)
 	{ l->kind.stmt = stmt;
@@ -122,44 +222,66 @@ void st_insert( char * name, ExpType type, int lineno, int loc, NodeKind nodekin
 	  l->kind.exp = exp;
 
     l->lines->next = NULL;
+    l->lastLine = l->lines;
+    l->func_scope = NULL;
+    l->global_order = (sl == globalScope) ? nGlobals++ : -1;
+    l->local_order = -1;
     l->next = sl->bucket[bh];
     sl->bucket[bh] = l;
+    if (curUnit != NULL && sl != globalScope)
+      add_local(curUnit,l);
   }
+  return l;
 } /* st_insert */
 
 void st_insert_lineno( BucketList bucket, int lineno )
-{ LineList t = bucket->lines;
-  while (t->next != NULL)
-  { if (t->lineno == lineno)
-      return ;
-
-    t = t->next;
+{ LineList t = bucket->lastLine;
+  /* global symbols are shared between units; their
+   * references are added when the unit is merged
+   */
+  if (curUnit != NULL && bucket->global_order >= 0)
+  { add_ref(curUnit,bucket,lineno);
+    return ;
   }
 
+  /* references arrive in source order, so a new
+   * line number usually just goes after the tail
+   */
   if (t->lineno == lineno)
-	return ;
+    return ;
+
+  if (t->lineno > lineno)
+  { for (t = bucket->lines; t != bucket->lastLine; t = t->next)
+      if (t->lineno == lineno)
+        return ;
+  }
 
-  t->next = (LineList) malloc(sizeof(struct LineListRec));
+  /* nodes after the tail are left by
+   * st_reset_lines for reuse
+   */
+  if (t->next == NULL)
+  { t->next = (LineList) tagAlloc(SymtabMem,sizeof(struct LineListRec));
+    t->next->next = NULL;
+  }
   t = t->next;
 
   t->lineno = lineno;
-  t->next = NULL;
+  bucket->lastLine = t;
 }
 
 BucketList st_lookup ( char * name )
 { ScopeList cur_scope = get_cur_scope();
+  int h = hash(name);
 
   while (cur_scope != NULL)
-  { int i;
-	for (i=0;i<SIZE;i++)
-    { BucketList cur_bucket = cur_scope->bucket[i];
-	  while (cur_bucket != NULL)
-      { if (strcmp(cur_bucket->name, name) == 0)
-	      return cur_bucket;
-
-		cur_bucket = cur_bucket->next;
-	  }
-	}
+  { BucketList cur_bucket = cur_scope->bucket[h];
+    while (cur_bucket != NULL)
+    { if (strcmp(cur_bucket->name, name) == 0 &&
+          cur_bucket->global_order < visibleGlobals)
+        return cur_bucket;
+
+      cur_bucket = cur_bucket->next;
+    }
 
     cur_scope = cur_scope->parent;
   }
@@ -167,23 +289,277 @@ BucketList st_lookup ( char * name )
   return NULL;
 }
 
+BucketList st_lookup_global ( char * name )
+{ BucketList l = globalScope->bucket[hash(name)];
+  while ((l != NULL) && (strcmp(name,l->name) != 0))
+    l = l->next;
+  return l;
+}
+
 BucketList st_lookup_excluding_parent ( char * name )
 { ScopeList cur_scope = get_cur_scope();
+  BucketList cur_bucket = cur_scope->bucket[hash(name)];
 
-  int i;
-  for (i=0;i<SIZE;i++)
-  { BucketList cur_bucket = cur_scope->bucket[i];
-    while (cur_bucket != NULL)
-	{ if (strcmp(cur_bucket->name, name) == 0)
-	    return cur_bucket;
+  while (cur_bucket != NULL)
+  { if (strcmp(cur_bucket->name, name) == 0)
+      return cur_bucket;
 
-	  cur_bucket = cur_bucket->next;
-	}
+    cur_bucket = cur_bucket->next;
   }
 
   return NULL;
 }
 
+/* Procedure st_begin_unit makes this thread analyze
+ * a unit: the body of the function whose scope is
+ * funcScope, seeing only the first visible global
+ * symbols. Scopes and global references are kept
+ * in unit until st_merge_unit
+ */
+void st_begin_unit( SymUnit unit, ScopeList funcScope, int visible )
+{ nScopeTop = 0;
+  nestedLv = 0;
+  push_scope(globalScope);
+  push_scope(funcScope);
+  varLocation[1] = funcScope->param_size;
+  nestedLv = 2;
+  curUnit = unit;
+  visibleGlobals = visible;
+}
+
+/* Procedure st_end_unit ends the unit of this thread */
+void st_end_unit(void)
+{ nScopeTop = 0;
+  nestedLv = 0;
+  curUnit = NULL;
+  visibleGlobals = INT_MAX;
+}
+
+/* Procedure st_collect keeps the scopes opened and
+ * the global references made by this thread in unit
+ * (or in the table again if unit is NULL)
+ */
+void st_collect( SymUnit unit )
+{ curUnit = unit;
+}
+
+/* Procedure st_begin_global makes this thread enter
+ * declarations in the global scope, keeping the
+ * scopes it opens in unit
+ */
+void st_begin_global( SymUnit unit )
+{ nScopeTop = 0;
+  nestedLv = 0;
+  push_scope(globalScope);
+  nestedLv = 1;
+  curUnit = unit;
+}
+
+/* Procedure st_merge_unit adds the scopes and global
+ * references of a finished unit to the table; units
+ * are merged in source order. The unit keeps them,
+ * so that it can be merged again
+ */
+void st_merge_unit( SymUnit unit )
+{ int i;
+  for (i=0;i<unit->nScopes;i++)
+    add_scope(unit->scopes[i]);
+  for (i=0;i<unit->nRefs;i++)
+    st_insert_lineno(unit->refBuckets[i],unit->refLines[i]);
+}
+
+/* Procedure st_clear_unit forgets the scopes and
+ * references of a unit that is analyzed again
+ */
+void st_clear_unit( SymUnit unit )
+{ unit->nScopes = 0;
+  unit->nRefs = 0;
+  unit->nLocals = 0;
+}
+
+/* Procedure st_free_unit releases a unit */
+void st_free_unit( SymUnit unit )
+{ free(unit->scopes);
+  free(unit->refBuckets);
+  free(unit->refLines);
+  free(unit->locals);
+  unit->scopes = NULL;
+  unit->refBuckets = NULL;
+  unit->refLines = NULL;
+  unit->locals = NULL;
+  unit->nScopes = unit->scopesSize = 0;
+  unit->nRefs = unit->refsSize = 0;
+  unit->nLocals = unit->localsSize = 0;
+}
+
+/* Procedure st_shift_unit moves every line number
+ * recorded by a unit by delta lines
+ */
+void st_shift_unit( SymUnit unit, int delta )
+{ int i;
+  for (i=0;i<unit->nLocals;i++)
+  { LineList t;
+    for (t=unit->locals[i]->lines;t!=NULL;t=t->next)
+      t->lineno += delta;
+  }
+  for (i=0;i<unit->nRefs;i++)
+    unit->refLines[i] += delta;
+}
+
+/* copy_lines returns a copy of line list t with
+ * every line moved by delta lines, and puts its
+ * tail in last
+ */
+static LineList copy_lines( LineList t, int delta, LineList * last )
+{ LineList head = NULL, * p = &head;
+  for (;t!=NULL;t=t->next)
+  { *p = (LineList) tagAlloc(SymtabMem,sizeof(struct LineListRec));
+    (*p)->lineno = t->lineno + delta;
+    *last = *p;
+    p = &(*p)->next;
+  }
+  *p = NULL;
+  return head;
+}
+
+/* copy_bucket returns a copy of local symbol l
+ * moved by delta lines, kept by unit
+ */
+static BucketList copy_bucket( SymUnit unit, BucketList l, int delta )
+{ BucketList c = (BucketList) tagAlloc(SymtabMem,sizeof(struct BucketListRec));
+  *c = *l;
+  c->lines = copy_lines(l->lines,delta,&c->lastLine);
+  c->next = NULL;
+  add_local(unit,c);
+  return c;
+}
+
+/* in_chain tells whether symbol l is in scope s */
+static int in_chain( ScopeList s, BucketList l )
+{ BucketList t;
+  for (t=s->bucket[hash(l->name)];t!=NULL;t=t->next)
+    if (t == l)
+      return TRUE;
+  return FALSE;
+}
+
+/* Procedure st_copy_unit makes unit dst, whose
+ * function scope holds its parameters, a copy of
+ * finished unit src, whose function has the same
+ * parameters and body delta lines earlier: the
+ * scopes, symbols and global references of the
+ * body are copied and moved by delta lines.
+ * Declarations come first in a block, so the
+ * symbols of each scope follow each other in the
+ * order of the scopes, and they are put into the
+ * copies in the order st_insert put them
+ */
+void st_copy_unit( SymUnit dst, SymUnit src, int delta )
+{ ScopeList * map = (ScopeList *) tagAlloc(SymtabMem,src->nScopes * sizeof(ScopeList));
+  int nParams = dst->nLocals, i, k;
+  map[0] = dst->scopes[0];
+  curUnit = dst;
+  for (i=1;i<src->nScopes;i++)
+  { ScopeList s = src->scopes[i], c;
+    c = (ScopeList) tagCalloc(SymtabMem,1,sizeof(struct ScopeListRec));
+    c->name = map[0]->name;
+    for (k=i-1;k>0 && src->scopes[k]!=s->parent;k--)
+      ;
+    c->parent = map[k];
+    c->nested_level = s->nested_level;
+    map[i] = c;
+    add_scope(c);
+  }
+  curUnit = NULL;
+  /* the parameters take the references of the body */
+  for (i=0;i<nParams;i++)
+  { BucketList d = dst->locals[i];
+    LineList t = d->lines;
+    while (t != NULL)
+    { LineList next = t->next;
+      free(t);
+      t = next;
+    }
+    d->lines = copy_lines(src->locals[i]->lines,delta,&d->lastLine);
+  }
+  for (i=nParams,k=0;i<src->nLocals;i++)
+  { BucketList l = src->locals[i], c;
+    int h = hash(l->name);
+    while (!in_chain(src->scopes[k],l))
+      k = (k+1) % src->nScopes;
+    c = copy_bucket(dst,l,delta);
+    c->next = map[k]->bucket[h];
+    map[k]->bucket[h] = c;
+  }
+  for (i=0;i<src->nRefs;i++)
+    add_ref(dst,src->refBuckets[i],src->refLines[i] + delta);
+  free(map);
+}
+
+/* Procedure st_reset_lines drops all but the first
+ * (declaring) line of global symbol l, so that the
+ * references of units can be merged again; the
+ * dropped nodes are reused by the merge, and
+ * st_trim_lines frees those left over
+ */
+void st_reset_lines( BucketList l )
+{ l->lastLine = l->lines;
+}
+
+void st_trim_lines( BucketList l )
+{ LineList t = l->lastLine->next;
+  l->lastLine->next = NULL;
+  while (t != NULL)
+  { LineList next = t->next;
+    free(t);
+    t = next;
+  }
+}
+
+/* Function st_scope_count returns the number of
+ * scopes in the table; st_truncate_scopes drops all
+ * but the first n
+ */
+int st_scope_count(void)
+{ return nScope;
+}
+
+void st_truncate_scopes( int n )
+{ nScope = n;
+}
+
+/* Function st_symbol_count returns the number of
+ * symbols in all scopes of the table
+ */
+long st_symbol_count(void)
+{ long n = 0;
+  int i, j;
+  for (i=0;i<nScope;i++)
+    for (j=0;j<SIZE;j++)
+    { BucketList l;
+      for (l=scopeTable[i]->bucket[j];l!=NULL;l=l->next)
+        n++;
+    }
+  return n;
+}
+
+/* Procedure st_reset empties the symbol table for
+ * the analysis of a new program
+ */
+void st_reset(void)
+{ nScope = 0;
+  nGlobals = 0;
+  nScopeTop = 0;
+  nestedLv = 0;
+}
+
+/* Function st_global_count returns the number of
+ * symbols declared in the global scope so far
+ */
+int st_global_count(void)
+{ return nGlobals;
+}
+
 /* Procedure printSymTab prints a formatted 
  * listing of the symbol table contents 
  * to the listing file
@@ -32,6 +32,10 @@ typedef struct BucketListRec
    { char * name;
      ExpType type;
      LineList lines;
+     LineList lastLine; /* tail of lines, for appending */
+     struct ScopeListRec * func_scope; /* scope of a function */
+     int global_order; /* declaration order, -1 if not global */
+     int local_order; /* index in the locals of its unit, or -1 */
      int memloc ; /* memory location for variable */
 	 NodeKind nodekind;
 	 union { StmtKind stmt; ExpKind exp; } kind;
@@ -47,7 +51,25 @@ typedef struct ScopeListRec
 	 int * param_list;
    } * ScopeList;
 
-int get_location();
+/* SymUnit collects the scopes opened and the global
+ * symbols referenced while one function body is
+ * analyzed, possibly in parallel with other bodies
+ */
+typedef struct SymUnitRec
+   { ScopeList * scopes;
+     int nScopes, scopesSize;
+     BucketList * refBuckets;
+     int * refLines;
+     int nRefs, refsSize;
+     BucketList * locals; /* symbols of its scopes */
+     int nLocals, localsSize;
+   } * SymUnit;
+
+/* Function get_location reserves size words for a
+ * variable of the current scope and returns its
+ * memory location
+ */
+int get_location(int size);
 
 void insert_scope(char * name);
 ScopeList get_cur_scope();
@@ -55,12 +77,13 @@ void del_cur_scope();
 void push_scope();
 ScopeList find_func_def_scope(char * name);
 
-/* Procedure st_insert inserts line numbers and
- * memory locations into the symbol table
+/* Function st_insert inserts line numbers and
+ * memory locations into the symbol table and
+ * returns the symbol
  * loc = memory location is inserted only the
  * first time, otherwise ignored
  */
-void st_insert( char * name, ExpType type, int lineno, int loc, NodeKind nodekind, StmtKind stmt, ExpKind exp );
+BucketList st_insert( char * name, ExpType type, int lineno, int loc, NodeKind nodekind, StmtKind stmt, ExpKind exp );
 void st_insert_lineno(BucketList bucket, int lineno);
 
 /* Function st_lookup returns the memory 
@@ -69,6 +92,86 @@ void st_insert_lineno(BucketList bucket, int lineno);
 BucketList st_lookup ( char * name );
 BucketList st_lookup_excluding_parent ( char * name );
 
+/* Function st_lookup_global returns the global
+ * symbol name, or NULL
+ */
+BucketList st_lookup_global ( char * name );
+
+/* Procedure st_begin_unit makes this thread analyze
+ * the body of the function whose scope is funcScope,
+ * seeing only the first visible global symbols
+ */
+void st_begin_unit( SymUnit unit, ScopeList funcScope, int visible );
+
+/* Procedure st_end_unit ends the unit of this thread */
+void st_end_unit(void);
+
+/* Procedure st_collect keeps the scopes opened and
+ * the global references made by this thread in unit
+ * (or in the table again if unit is NULL)
+ */
+void st_collect( SymUnit unit );
+
+/* Procedure st_begin_global makes this thread enter
+ * declarations in the global scope, keeping the
+ * scopes it opens in unit
+ */
+void st_begin_global( SymUnit unit );
+
+/* Procedure st_merge_unit adds the scopes and global
+ * references of a finished unit to the table
+ */
+void st_merge_unit( SymUnit unit );
+
+/* Procedure st_clear_unit forgets the scopes and
+ * references of a unit that is analyzed again;
+ * st_free_unit releases a unit
+ */
+void st_clear_unit( SymUnit unit );
+void st_free_unit( SymUnit unit );
+
+/* Procedure st_shift_unit moves every line number
+ * recorded by a unit by delta lines
+ */
+void st_shift_unit( SymUnit unit, int delta );
+
+/* Procedure st_copy_unit makes unit dst, whose
+ * function scope holds its parameters, a copy of
+ * finished unit src, whose function has the same
+ * parameters and body delta lines earlier
+ */
+void st_copy_unit( SymUnit dst, SymUnit src, int delta );
+
+/* Procedure st_reset_lines drops all but the first
+ * (declaring) line of a global symbol before its
+ * references are merged again; st_trim_lines ends
+ * the merge
+ */
+void st_reset_lines( BucketList );
+void st_trim_lines( BucketList );
+
+/* Function st_scope_count returns the number of
+ * scopes in the table; st_truncate_scopes drops all
+ * but the first n
+ */
+int st_scope_count(void);
+void st_truncate_scopes( int n );
+
+/* Function st_symbol_count returns the number of
+ * symbols in all scopes of the table
+ */
+long st_symbol_count(void);
+
+/* Procedure st_reset empties the symbol table for
+ * the analysis of a new program
+ */
+void st_reset(void);
+
+/* Function st_global_count returns the number of
+ * symbols declared in the global scope so far
+ */
+int st_global_count(void);
+
 /* Procedure printSymTab prints a formatted 
  * listing of the symbol table contents 
  * to the listing file
@@ -0,0 +1,77 @@
+#!/bin/sh
+#
+# stress.sh: regression test for very long statement
+# lists and very deep nesting
+#
+# usage (in project3, after make):
+#   test/stress.sh [compiler]
+#   make stress
+#
+# It writes two programs into a scratch directory:
+#   long.cm  a main of $LONG assignments (100000)
+#   deep.cm  $DEEP whiles nested in each other (20000)
+# and compiles each, optimized and with -O0, with the
+# stack limited to 256 KB, so a pass that recurses
+# once per statement or per level overflows it. Each
+# must compile with no error into a .tm file. The
+# programs are only compiled: deep.cm never ends.
+#
+
+CM=${1:-./cminus_semantic}
+LONG=${LONG:-100000}
+DEEP=${DEEP:-20000}
+
+case $CM in
+  /*) ;;
+  *) CM=`pwd`/$CM ;;
+esac
+if [ ! -x "$CM" ]; then
+  echo "stress.sh: no compiler $CM; run make first"
+  exit 2
+fi
+
+# the compiler names the code file after the part of
+# its argument up to the first dot, so it is run in
+# the scratch directory on a bare file name
+DIR=`mktemp -d` || exit 2
+trap 'rm -rf "$DIR"' 0
+cd "$DIR" || exit 2
+
+awk -v n=$LONG 'BEGIN {
+  print "void main(void)"
+  print "{ int s; int i; int k;"
+  print "  s = 0; i = input(); k = 3;"
+  for (j = 0; j < n; j++)
+    print "  s = s + i * k;"
+  print "  output(s);"
+  print "}"
+}' > long.cm
+
+awk -v n=$DEEP 'BEGIN {
+  print "void main(void)"
+  print "{ int i;"
+  print "  i = input();"
+  for (j = 0; j < n; j++)
+    print "  while (i > " j ") {"
+  print "  output(i); i = i - 1;"
+  for (j = 0; j < n; j++)
+    print "  }"
+  print "}"
+}' > deep.cm
+
+fail=0
+for f in long deep; do
+  for opt in "" -O0; do
+    rm -f $f.tm
+    ( ulimit -s 256; "$CM" $opt $f.cm ) > $f.lst 2>&1
+    status=$?
+    if [ $status -ne 0 ] || [ ! -s $f.tm ] || grep -q "error" $f.lst; then
+      echo "FAIL: $f.cm $opt (exit $status)"
+      grep "error" $f.lst | head -5
+      fail=1
+    else
+      echo "ok: $f.cm $opt"
+    fi
+  done
+done
+exit $fail
@@ -0,0 +1,214 @@
+#!/bin/sh
+#
+# watch.sh: regression test for -watch, which must
+# list each version of the program as a compiler
+# started on it would
+#
+# usage (in project3, after make):
+#   test/watch.sh [compiler]
+#   make watchtest
+#
+# First it watches a correct program in a scratch
+# directory, then in turn reads an undeclared
+# variable in an expression and in a return, and
+# undoes each edit. The listing of each fixed
+# version must be that of the first one, with no
+# error left over from the edit before it.
+#
+# Then it watches a program of several functions
+# through a series of edits, each of the program
+# first watched, and compares the listing of each
+# version with that of a compiler started on it, so
+# nothing of a freed version may leak into the next
+#
+
+CM=${1:-./cminus_semantic}
+
+case $CM in
+  /*) ;;
+  *) CM=`pwd`/$CM ;;
+esac
+if [ ! -x "$CM" ]; then
+  echo "watch.sh: no compiler $CM; run make first"
+  exit 2
+fi
+
+DIR=`mktemp -d` || exit 2
+pid=
+trap '[ -n "$pid" ] && kill $pid 2>/dev/null; rm -rf "$DIR"' 0
+cd "$DIR" || exit 2
+
+# waitFor waits until listing $2 has $1 versions
+waitFor()
+{ i=0
+  while [ `grep -c "^Re-checked" $2` -lt $1 ]; do
+    i=`expr $i + 1`
+    if [ $i -gt 100 ]; then
+      echo "FAIL: version $1 never checked"
+      cat $2
+      exit 1
+    fi
+    sleep 0.1
+  done
+}
+
+# edit makes a.cm good.cm with the text $1 replaced
+# by $2, or good.cm itself; a.cm is replaced whole,
+# so that it is never read half written, and its
+# time changes
+edit()
+{ if [ $# -eq 0 ]; then
+    cp good.cm b.cm
+  else
+    sed "s/$1/$2/" good.cm > b.cm
+  fi
+  sleep 0.1
+  mv b.cm a.cm
+}
+
+# split puts version n of listing $1 into $2n.lst,
+# without the time taken and blank lines
+split()
+{ awk -v p=$2 '/^CMINUS COMPILATION/ { n++ }
+    NF && !/^Re-checked/ { print > (p n ".lst") }' $1
+}
+
+# fresh puts the listing of a compiler started on
+# file $1 into fresh.lst
+fresh()
+{ mkdir -p fresh
+  cp $1 fresh/a.cm
+  ( cd fresh
+    "$CM" -watch a.cm > out.lst 2>&1 &
+    p=$!
+    waitFor 1 out.lst
+    rm a.cm
+    wait $p
+    split out.lst v )
+  mv fresh/v1.lst fresh.lst
+}
+
+fail=0
+
+cat > good.cm <<'EOF'
+int f(int x)
+{ int y;
+  y = x + 1;
+  return y;
+}
+void main(void)
+{ output(f(3));
+}
+EOF
+cp good.cm a.cm
+
+"$CM" -watch a.cm > out.lst 2>&1 &
+pid=$!
+waitFor 1 out.lst
+edit "y = x + 1" "y = x + q"
+waitFor 2 out.lst
+edit
+waitFor 3 out.lst
+edit "return y" "return q"
+waitFor 4 out.lst
+edit
+waitFor 5 out.lst
+rm a.cm
+wait $pid
+pid=
+
+split out.lst v
+for n in 2 4; do
+  if ! grep -q "Undeclared variable \"q\"" v$n.lst; then
+    echo "FAIL: version $n: no error for q"
+    fail=1
+  fi
+done
+for n in 3 5; do
+  if ! cmp -s v1.lst v$n.lst; then
+    echo "FAIL: version $n differs from version 1:"
+    diff v1.lst v$n.lst
+    fail=1
+  fi
+done
+[ $fail -eq 0 ] && echo "ok: watch, errors fixed"
+
+cat > good.cm <<'EOF'
+int a;
+int b[4];
+int c;
+int f(int x, int y[])
+{ int i; int s;
+  i = 0; s = 0;
+  while (i < x) { s = s + y[i]; i = i + 1; }
+  return s;
+}
+int g(int x)
+{ int t;
+  t = x * 2;
+  if (t > 3) t = t - 1; else t = t + 1;
+  return t;
+}
+void h(void)
+{ int k;
+  k = g(a);
+  output(k);
+  output(f(c, b));
+}
+void main(void)
+{ int z;
+  a = input(); c = 2;
+  b[0] = 1; b[1] = 2;
+  h();
+  z = g(c);
+  output(z);
+}
+EOF
+cp good.cm a.cm
+cp good.cm t1.cm
+
+"$CM" -watch a.cm > out.lst 2>&1 &
+pid=$!
+waitFor 1 out.lst
+n=1
+while IFS='|' read from to; do
+  n=`expr $n + 1`
+  edit "$from" "$to"
+  cp a.cm t$n.cm
+  waitFor $n out.lst
+done <<'EOF'
+int c;|int c; int d;
+s = s + y\[i\];|s = s + y[i] * 2;
+t = x \* 2;|t = x * 3;
+output(k);|output(k); output(k + 1);
+int a;|int a; int e;
+return t;|return t + a;
+z = g(c);|z = g(c) + f(c, b);
+int k;|int k; int m;
+i = 0;|i = 1;
+h();|h(); h();
+int b\[4\];|int b[5];
+output(z);|output(z); output(a);
+if (t > 3)|if (t > 4)
+c = 2;|c = 3;
+int z;|int z; int w;
+return s;|return s - 1;
+void h(void)|void hh(void)
+EOF
+rm a.cm
+wait $pid
+pid=
+
+split out.lst w
+k=1
+while [ $k -le $n ]; do
+  fresh t$k.cm
+  if ! cmp -s fresh.lst w$k.lst; then
+    echo "FAIL: version $k differs from a compiler started on it:"
+    diff fresh.lst w$k.lst | head -20
+    fail=1
+  fi
+  k=`expr $k + 1`
+done
+[ $fail -eq 0 ] && echo "ok: watch, $n versions"
+exit $fail
@@ -8,6 +8,7 @@
 
 #include "globals.h"
 #include "util.h"
+#include "stats.h"
 
 /* Procedure printToken prints a token 
  * and its lexeme to the listing file
@@ -49,6 +50,7 @@ void printToken( TokenType token, const char* tokenString )
     case TIMES: fprintf(listing,"*\n"); break;
     case OVER: fprintf(listing,"/\n"); break;
     case ENDFILE: fprintf(listing,"EOF\n"); break;
+    case LAZYBODY: fprintf(listing,"{ ... }\n"); break;
     case NUM:
       fprintf(listing,
           "NUM, val= %s\n",tokenString);
@@ -66,22 +68,35 @@ void printToken( TokenType token, const char* tokenString )
   }
 }
 
+/* the TypeK nodes shared by every declaration:
+ * var_type points to one of these two
+ */
+TreeNode voidTypeNode = { .nodekind = StmtK, .kind.stmt = TypeK, .type = Void };
+TreeNode intTypeNode = { .nodekind = StmtK, .kind.stmt = TypeK, .type = Integer };
+
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  */
 TreeNode * newStmtNode(StmtKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
+{ TreeNode * t = (TreeNode *) tagAlloc(ParseMem,sizeof(TreeNode));
   int i;
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
   else {
+    nodeCount++;
     for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
     t->sibling = NULL;
+	t->var_type = NULL;
 	t->is_array = FALSE;
 	t->is_argu = FALSE;
+	t->param_size = 0;
+	t->param_list = NULL;
+	t->lazy_body = NULL;
+	t->symbol = NULL;
     t->nodekind = StmtK;
     t->kind.stmt = kind;
     t->lineno = lineno;
+    t->type = Void;
   }
   return t;
 }
@@ -90,13 +105,21 @@ TreeNode * newStmtNode(StmtKind kind)
  * node for syntax tree construction
  */
 TreeNode * newExpNode(ExpKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
+{ TreeNode * t = (TreeNode *) tagAlloc(ParseMem,sizeof(TreeNode));
   int i;
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
   else {
+    nodeCount++;
     for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
     t->sibling = NULL;
+	t->var_type = NULL;
+	t->is_array = FALSE;
+	t->is_argu = FALSE;
+	t->param_size = 0;
+	t->param_list = NULL;
+	t->lazy_body = NULL;
+	t->symbol = NULL;
     t->nodekind = ExpK;
     t->kind.exp = kind;
     t->lineno = lineno;
@@ -113,13 +136,225 @@ char * copyString(char * s)
   char * t;
   if (s==NULL) return NULL;
   n = strlen(s)+1;
-  t = malloc(n);
+  t = tagAlloc(ScanMem,n);
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
   else strcpy(t,s);
   return t;
 }
 
+/* TravFrame records a node whose subtrees are
+ * being traversed and the next child to visit
+ */
+typedef struct
+   { TreeNode * node;
+     int child;
+   } TravFrame;
+
+/* initial depth of the traversal stack */
+#define TRAVSTACK 64
+
+static const NodeProc noProcs[NODETYPES];
+
+/* Procedure traverseTree is a generic syntax tree
+ * traversal routine:
+ * it applies visitor preProc in preorder and
+ * postProc in postorder to tree pointed to by t,
+ * dispatching on the NodeType of each node.
+ * Pending nodes are kept on a heap-allocated
+ * stack and siblings replace each other in the
+ * same frame, so neither deep nesting nor long
+ * statement lists grow the C call stack
+ */
+void traverseTree( TreeNode * t, const NodeProc * preProc,
+                   const NodeProc * postProc )
+{ TravFrame * stack;
+  int top = 0, size = TRAVSTACK;
+  if (t == NULL) return;
+  if (preProc == NULL) preProc = noProcs;
+  if (postProc == NULL) postProc = noProcs;
+  stack = (TravFrame *) tagAlloc(OtherMem,size * sizeof(TravFrame));
+  visitNode(preProc,t);
+  stack[top].node = t;
+  stack[top].child = 0;
+  top++;
+  while (top > 0)
+  { TravFrame * f = &stack[top-1];
+    if (f->child < MAXCHILDREN)
+    { TreeNode * c = f->node->child[f->child++];
+      if (c != NULL)
+      { if (top == size)
+        { size *= 2;
+          stack = (TravFrame *) tagRealloc(OtherMem,stack,size * sizeof(TravFrame));
+        }
+        visitNode(preProc,c);
+        stack[top].node = c;
+        stack[top].child = 0;
+        top++;
+      }
+    }
+    else
+    { visitNode(postProc,f->node);
+      if (f->node->sibling != NULL)
+      { f->node = f->node->sibling;
+        f->child = 0;
+        visitNode(preProc,f->node);
+      }
+      else
+        top--;
+    }
+  }
+  free(stack);
+}
+
+/* Procedure freeTree frees the tree pointed to by
+ * t and its siblings, with the names in its nodes
+ */
+void freeTree( TreeNode * t )
+{ TreeNode ** stack;
+  int top = 0, size = TRAVSTACK, i;
+  if (t == NULL) return;
+  stack = (TreeNode **) tagAlloc(OtherMem,size * sizeof(TreeNode *));
+  stack[top++] = t;
+  while (top > 0)
+  { t = stack[--top];
+    if (top + MAXCHILDREN + 1 > size)
+    { size *= 2;
+      stack = (TreeNode **) tagRealloc(OtherMem,stack,size * sizeof(TreeNode *));
+    }
+    if (t->sibling != NULL) stack[top++] = t->sibling;
+    for (i=0;i<MAXCHILDREN;i++)
+      if (t->child[i] != NULL) stack[top++] = t->child[i];
+    switch (nodeType(t))
+    { case VarT: case ParamT: case FuncT: case CallT: case IdT:
+        free(t->attr.name);
+        break;
+      case ArrVarT: case ArrParamT:
+        free(t->attr.arr.name);
+        break;
+      default:
+        break;
+    }
+    free(t->lazy_body);
+    free(t);
+  }
+  free(stack);
+}
+
+/* Function pairTrees applies proc to the pairs of
+ * corresponding nodes of the trees pointed to by a
+ * and b and their siblings. It returns FALSE as
+ * soon as the shapes of the trees differ or proc
+ * returns FALSE, and TRUE otherwise
+ */
+int pairTrees( TreeNode * a, TreeNode * b, PairProc proc )
+{ TreeNode ** stack;
+  int top = 0, size = TRAVSTACK, i, same = TRUE;
+  stack = (TreeNode **) tagAlloc(OtherMem,2 * size * sizeof(TreeNode *));
+  stack[top++] = a;
+  stack[top++] = b;
+  while (top > 0 && same)
+  { b = stack[--top];
+    a = stack[--top];
+    if (a == NULL || b == NULL)
+    { same = a == b;
+      continue;
+    }
+    if (!proc(a,b))
+    { same = FALSE;
+      continue;
+    }
+    if (top + 2 * (MAXCHILDREN+1) > 2 * size)
+    { size *= 2;
+      stack = (TreeNode **) tagRealloc(OtherMem,stack,2 * size * sizeof(TreeNode *));
+    }
+    stack[top++] = a->sibling;
+    stack[top++] = b->sibling;
+    for (i=MAXCHILDREN-1;i>=0;i--)
+    { stack[top++] = a->child[i];
+      stack[top++] = b->child[i];
+    }
+  }
+  free(stack);
+  return same;
+}
+
+/* FNV-1a style hashing, mixing a whole word at a
+ * time; the shift folds the high bits of each
+ * product back into the low bits
+ */
+#define HASHPRIME 1099511628211UL
+
+unsigned long hashInt(unsigned long h, long x)
+{ h = (h ^ (unsigned long) x) * HASHPRIME;
+  return h ^ (h >> 29);
+}
+
+unsigned long hashString(unsigned long h, const char * s)
+{ if (s == NULL)
+    return hashInt(h,-1);
+  while (*s != '\0')
+    h = (h ^ (unsigned char) *s++) * HASHPRIME;
+  return (h ^ 0xff) * HASHPRIME;
+}
+
+/* Function hashNode returns a hash of the contents
+ * of node t alone, without its subtrees
+ */
+unsigned long hashNode( TreeNode * t )
+{ unsigned long h = HASHBASIS;
+  h = hashInt(h,nodeType(t));
+  h = hashInt(h,t->is_array);
+  switch (nodeType(t))
+  { case VarT: case ParamT: case FuncT:
+      h = hashInt(h,t->var_type == &intTypeNode);
+      /* fall through */
+    case CallT: case IdT:
+      h = hashString(h,t->attr.name);
+      break;
+    case ArrVarT: case ArrParamT:
+      h = hashInt(h,t->var_type == &intTypeNode);
+      h = hashString(h,t->attr.arr.name);
+      h = hashInt(h,t->attr.arr.size);
+      break;
+    case OpT:
+      h = hashInt(h,t->attr.op);
+      break;
+    case ConstT:
+      h = hashInt(h,t->attr.val);
+      break;
+    default:
+      break;
+  }
+  return h;
+}
+
+static __thread unsigned long treeHash;
+
+static void hashEnter(TreeNode * t)
+{ int shape = 0, i;
+  /* which children and sibling are present, so that
+   * the preorder sequence of hashes fixes the shape
+   */
+  for (i=0;i<MAXCHILDREN;i++)
+    if (t->child[i] != NULL) shape |= 1 << i;
+  if (t->sibling != NULL) shape |= 1 << MAXCHILDREN;
+  treeHash = hashInt(treeHash,shape);
+  treeHash = (treeHash ^ hashNode(t)) * HASHPRIME;
+}
+
+static const NodeProc hashVisitor[NODETYPES] = EVERYNODE(hashEnter);
+
+/* Function hashTree returns a hash of the structure
+ * and contents of the tree pointed to by t and its
+ * siblings; line numbers are left out
+ */
+unsigned long hashTree( TreeNode * t )
+{ treeHash = HASHBASIS;
+  traverseTree(t,hashVisitor,NULL);
+  return treeHash;
+}
+
 /* Variable indentno is used by printTree to
  * store current number of spaces to indent
  */
@@ -144,92 +379,111 @@ void printType(ExpType type) {
 	fprintf(listing," type : int");
 }
 
+static void printVar(TreeNode * tree)
+{ fprintf(listing,"Var declaration, name : %s,", tree->attr.name);
+  printType(tree->var_type->type); fprintf(listing, "\n");
+}
+
+static void printArrVar(TreeNode * tree)
+{ fprintf(listing,"Var declaration, name : %s", tree->attr.arr.name);
+  printType(tree->var_type->type); fprintf(listing,"[%d]\n", tree->attr.arr.size);
+}
+
+static void printParam(TreeNode * tree)
+{ fprintf(listing,"Parameter, name : %s,", tree->attr.name);
+  printType(tree->var_type->type); fprintf(listing,"\n");
+}
+
+static void printArrParam(TreeNode * tree)
+{ fprintf(listing,"Parameter, name : %s", tree->attr.arr.name);
+  printType(tree->var_type->type); fprintf(listing,"[]\n");
+}
+
+static void printFunc(TreeNode * tree)
+{ fprintf(listing,"Function declaration, name : %s, return", tree->attr.name);
+  printType(tree->var_type->type); fprintf(listing, "\n");
+}
+
+static void printComp(TreeNode * tree)
+{ fprintf(listing, "Compound statement :\n");
+}
+
+static void printIf(TreeNode * tree)
+{ fprintf(listing,"If (condition) (body)");
+  if (tree->child[2]!=NULL)
+	fprintf(listing," (else)\n");
+}
+
+static void printWhile(TreeNode * tree)
+{ fprintf(listing,"While\n");
+}
+
+static void printReturn(TreeNode * tree)
+{ fprintf(listing,"Return :\n");
+}
+
+static void printAssign(TreeNode * tree)
+{ fprintf(listing,"Assign (destination) (source)\n");
+}
+
+static void printCall(TreeNode * tree)
+{ fprintf(listing,"Call, name : %s, with arguments below\n", tree->attr.name);
+}
+
+static void printOp(TreeNode * tree)
+{ fprintf(listing,"Op: ");
+  printToken(tree->attr.op,"\0");
+}
+
+static void printConst(TreeNode * tree)
+{ fprintf(listing,"Const: %d\n",tree->attr.val);
+}
+
+static void printId(TreeNode * tree)
+{ if (tree->child[0] == NULL)
+    fprintf(listing,"Id: %s\n",tree->attr.name);
+  else
+    fprintf(listing,"Id: %s[exp]\n",tree->attr.arr.name);
+}
+
+static void printNullParam(TreeNode * tree)
+{ fprintf(listing,"Parameter, name : (null), type : void\n");
+}
+
+static void printUnknown(TreeNode * tree)
+{ fprintf(listing,"Unknown ExpNode kind\n");
+}
+
+static const NodeProc printNode[NODETYPES] =
+   { [VarT] = printVar, [ArrVarT] = printArrVar,
+     [ParamT] = printParam, [ArrParamT] = printArrParam,
+     [FuncT] = printFunc, [CompT] = printComp,
+     [IfT] = printIf, [WhileT] = printWhile,
+     [ReturnT] = printReturn, [AssignT] = printAssign,
+     [CallT] = printCall, [OpT] = printOp,
+     [ConstT] = printConst, [IdT] = printId,
+     [NullParamT] = printNullParam, [UnknownT] = printUnknown };
+
+/* a node is printed indented one step deeper
+ * than its parent
+ */
+static void enterNode(TreeNode * tree)
+{ INDENT;
+  printSpaces();
+  visitNode(printNode,tree);
+}
+
+static void leaveNode(TreeNode * tree)
+{ UNINDENT;
+}
+
+static const NodeProc printEnter[NODETYPES] = EVERYNODE(enterNode);
+
+static const NodeProc printLeave[NODETYPES] = EVERYNODE(leaveNode);
+
 /* procedure printTree prints a syntax tree to the 
  * listing file using indentation to indicate subtrees
  */
 void printTree( TreeNode * tree )
-{ int i;
-  INDENT;
-  while (tree != NULL) {
-    printSpaces();
-    if (tree->nodekind==StmtK)
-    { switch (tree->kind.stmt) {
-		case VarK:
-          fprintf(listing,"Var declaration, name : %s,", tree->attr.name);
-		  printType(tree->var_type->type); fprintf(listing, "\n");
-		  break;
-		case ArrVarK:
-          fprintf(listing,"Var declaration, name : %s", tree->attr.arr.name);
-          printType(tree->var_type->type); fprintf(listing,"[%d]\n", tree->attr.arr.size);
-		  break;
-		case ParamK:
-		  fprintf(listing,"Parameter, name : %s,", tree->attr.name);
-          printType(tree->var_type->type); fprintf(listing,"\n");
-		  break;
-		case ArrParamK:
-		  fprintf(listing,"Parameter, name : %s", tree->attr.arr.name);
-          printType(tree->var_type->type); fprintf(listing,"[]\n");
-		  break;
-		case FuncK:
-		  fprintf(listing,"Function declaration, name : %s, return", tree->attr.name);
-		  printType(tree->var_type->type); fprintf(listing, "\n");
-		  break;
-		case CompK:
-		  fprintf(listing, "Compound statement :\n");
-		  break;
-        case IfK:
-          fprintf(listing,"If (condition) (body)");
-		  if (tree->child[2]!=NULL)
-			fprintf(listing," (else)\n");
-          break;
-        case WhileK:
-          fprintf(listing,"While\n");
-          break;
-		case ReturnK:
-		  fprintf(listing,"Return :\n");
-		  break;
-        case AssignK:
-          fprintf(listing,"Assign (destination) (source)\n");
-          break;
-		case CallK:
-		  fprintf(listing,"Call, name : %s, with arguments below\n", tree->attr.name);
-		  break;
-		case TypeK:
-		  break;
-		default:
-          fprintf(listing,"Unknown StmtNode kind %d\n", tree->kind.stmt);
-          break;
-      }
-    }
-    else if (tree->nodekind==ExpK)
-    { switch (tree->kind.exp) {
-        case OpK:
-          fprintf(listing,"Op: ");
-          printToken(tree->attr.op,"\0");
-          break;
-        case ConstK:
-          fprintf(listing,"Const: %d\n",tree->attr.val);
-          break;
-        case IdK:
-		  if (tree->child[0] == NULL)
-            fprintf(listing,"Id: %s\n",tree->attr.name);
-		  else
-		    fprintf(listing,"Id: %s[exp]\n",tree->attr.arr.name);
-
-          break;
-		case NullParamK:
-		  fprintf(listing,"Parameter, name : (null), type : void\n");
-		  break;
-        default:
-          fprintf(listing,"Unknown ExpNode kind\n");
-          break;
-      }
-    }
-    else fprintf(listing,"Unknown node kind\n");
-    for (i=0;i<MAXCHILDREN;i++)
-         printTree(tree->child[i]);
-    tree = tree->sibling;
-  }
-  UNINDENT;
+{ traverseTree(tree,printEnter,printLeave);
 }
-
@@ -28,6 +28,67 @@ TreeNode * newExpNode(ExpKind);
  */
 char * copyString( char * );
 
+/* NodeProc handles one node during a traversal;
+ * a visitor is a table of NodeProcs indexed by
+ * NodeType, where NULL entries do nothing
+ */
+typedef void (* NodeProc)(TreeNode *);
+
+/* visitNode applies visitor v to node t */
+#define visitNode(v,t) \
+  do { NodeProc p_ = (v)[nodeType(t)]; if (p_ != NULL) p_(t); } while (0)
+
+/* EVERYNODE(p) initializes a visitor that applies
+ * p to every kind of node
+ */
+#define EVERYNODE(p) { [0 ... NODETYPES-1] = (p) }
+
+/* Procedure traverseTree applies visitor preProc in
+ * preorder and postProc in postorder to the tree
+ * pointed to by t and its siblings; either may be
+ * NULL
+ */
+void traverseTree( TreeNode * t, const NodeProc * preProc,
+                   const NodeProc * postProc );
+
+/* Procedure freeTree frees the tree pointed to by
+ * t and its siblings, with the names in its nodes
+ */
+void freeTree( TreeNode * t );
+
+/* Functions hashInt and hashString mix an integer
+ * or a string into hash h; a hash starts out as
+ * HASHBASIS
+ */
+#define HASHBASIS 14695981039346656037UL
+unsigned long hashInt(unsigned long h, long x);
+unsigned long hashString(unsigned long h, const char * s);
+
+/* PairProc compares or handles two corresponding
+ * nodes of two trees
+ */
+typedef int (* PairProc)(TreeNode *, TreeNode *);
+
+/* Function pairTrees applies proc to the pairs of
+ * corresponding nodes of the trees pointed to by a
+ * and b and their siblings. It returns FALSE as
+ * soon as the shapes of the trees differ or proc
+ * returns FALSE, and TRUE otherwise
+ */
+int pairTrees( TreeNode * a, TreeNode * b, PairProc proc );
+
+/* Function hashTree returns a hash of the structure
+ * and contents of the tree pointed to by t and its
+ * siblings; line numbers are left out, so moving
+ * code does not change its hash
+ */
+unsigned long hashTree( TreeNode * t );
+
+/* Function hashNode returns a hash of the contents
+ * of node t alone, without its subtrees
+ */
+unsigned long hashNode( TreeNode * t );
+
 /* procedure printTree prints a syntax tree to the 
  * listing file using indentation to indicate subtrees
  */
@@ -0,0 +1,131 @@
+/****************************************************/
+/* File: workpool.c                                 */
+/* Work-stealing thread pool implementation for the */
+/* C-minus compiler                                 */
+/****************************************************/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "workpool.h"
+#include "stats.h"
+
+/* TaskRange is the deque of one worker: the owner
+ * takes tasks from lo, thieves split off tasks
+ * from hi
+ */
+typedef struct
+   { int lo, hi;
+     pthread_mutex_t lock;
+   } TaskRange;
+
+typedef struct
+   { TaskRange * ranges;
+     int nThreads;
+     TaskProc proc;
+     void * arg;
+   } Pool;
+
+typedef struct
+   { Pool * pool;
+     int self;
+   } Worker;
+
+/* takes the next task of range r, or -1 */
+static int takeTask(TaskRange * r)
+{ int task = -1;
+  pthread_mutex_lock(&r->lock);
+  if (r->lo < r->hi)
+    task = r->lo++;
+  pthread_mutex_unlock(&r->lock);
+  return task;
+}
+
+/* moves the upper half of the largest range of
+ * another worker into range self; returns 0
+ * if there is nothing left to steal
+ */
+static int steal(Pool * pool, int self)
+{ int i, victim = -1, most = 0;
+  for (i=0;i<pool->nThreads;i++)
+  { TaskRange * r = &pool->ranges[i];
+    int left;
+    if (i == self)
+      continue;
+    /* the owner moves lo under the lock */
+    pthread_mutex_lock(&r->lock);
+    left = r->hi - r->lo;
+    pthread_mutex_unlock(&r->lock);
+    if (left > most)
+    { most = left;
+      victim = i;
+    }
+  }
+  if (victim < 0)
+    return 0;
+  { TaskRange * v = &pool->ranges[victim];
+    TaskRange * r = &pool->ranges[self];
+    int lo, hi;
+    pthread_mutex_lock(&v->lock);
+    hi = v->hi;
+    lo = v->hi - (v->hi - v->lo + 1) / 2;
+    v->hi = lo;
+    pthread_mutex_unlock(&v->lock);
+    pthread_mutex_lock(&r->lock);
+    r->lo = lo;
+    r->hi = hi;
+    pthread_mutex_unlock(&r->lock);
+  }
+  return 1;
+}
+
+static void * work(void * p)
+{ Worker * w = (Worker *) p;
+  Pool * pool = w->pool;
+  int task;
+  for (;;)
+  { task = takeTask(&pool->ranges[w->self]);
+    if (task >= 0)
+      pool->proc(task,pool->arg);
+    else if (!steal(pool,w->self))
+      break;
+  }
+  return NULL;
+}
+
+void runTasks(int nTasks, int nThreads, TaskProc proc, void * arg)
+{ Pool pool;
+  Worker * workers;
+  pthread_t * threads;
+  int i;
+  if (nThreads > nTasks)
+    nThreads = nTasks;
+  if (nThreads <= 1)
+  { for (i=0;i<nTasks;i++)
+      proc(i,arg);
+    return;
+  }
+  pool.ranges = (TaskRange *) tagAlloc(OtherMem,nThreads * sizeof(TaskRange));
+  pool.nThreads = nThreads;
+  pool.proc = proc;
+  pool.arg = arg;
+  workers = (Worker *) tagAlloc(OtherMem,nThreads * sizeof(Worker));
+  threads = (pthread_t *) tagAlloc(OtherMem,nThreads * sizeof(pthread_t));
+  for (i=0;i<nThreads;i++)
+  { pool.ranges[i].lo = (int) ((long) nTasks * i / nThreads);
+    pool.ranges[i].hi = (int) ((long) nTasks * (i+1) / nThreads);
+    pthread_mutex_init(&pool.ranges[i].lock,NULL);
+    workers[i].pool = &pool;
+    workers[i].self = i;
+  }
+  /* the calling thread is worker 0 */
+  for (i=1;i<nThreads;i++)
+    pthread_create(&threads[i],NULL,work,&workers[i]);
+  work(&workers[0]);
+  for (i=1;i<nThreads;i++)
+    pthread_join(threads[i],NULL);
+  for (i=0;i<nThreads;i++)
+    pthread_mutex_destroy(&pool.ranges[i].lock);
+  free(pool.ranges);
+  free(workers);
+  free(threads);
+}
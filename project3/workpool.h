@@ -0,0 +1,21 @@
+/****************************************************/
+/* File: workpool.h                                 */
+/* Work-stealing thread pool interface for the      */
+/* C-minus compiler                                 */
+/****************************************************/
+
+#ifndef _WORKPOOL_H_
+#define _WORKPOOL_H_
+
+/* TaskProc runs task number task of a pool run */
+typedef void (* TaskProc)(int task, void * arg);
+
+/* Procedure runTasks runs tasks 0..nTasks-1 on
+ * nThreads threads and returns when all are done.
+ * Each thread starts on its own contiguous range
+ * of tasks; a thread that runs out steals the
+ * upper half of the largest remaining range
+ */
+void runTasks(int nTasks, int nThreads, TaskProc proc, void * arg);
+
+#endif